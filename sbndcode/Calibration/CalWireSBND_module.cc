@@ -9,6 +9,7 @@
 //  copied over and modified to SBND   
 ////////////////////////////////////////////////////////////////////////
 
+#include <memory>
 #include <string>
 #include <vector>
 #include <stdint.h>
@@ -30,6 +31,11 @@
 #include "lardata/ArtDataHelper/WireCreator.h"
 
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/FFTPlanCacheSBND.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
+#include "sbndcode/Utilities/RawDigitUtilsSBND.h"
+#include "sbndcode/Utilities/BaselineUtilsSBND.h"
+#include "sbndcode/Utilities/ThreadUtilsSBND.h"
 #include "sbndcode/Calibration/IROIFinder.h"
 #include "larcore/Geometry/Geometry.h"
 //#include "Filters/ChannelFilter.h"
@@ -44,7 +50,6 @@
 
 #include "TComplex.h"
 #include "TFile.h"
-#include "TH1F.h"
 
 ///creation of calibrated signals on wires
 namespace caldata {
@@ -75,7 +80,26 @@ namespace caldata {
     using CandidateROIVec = std::vector<CandidateROI>;
 
   private:
-    
+
+    // Work buffers owned by one worker thread.
+    struct Workspace {
+      std::unique_ptr<util::FFTWorkspaceSBND> fft;
+      std::vector<float>                      holder;   ///< holds signal data
+      util::RawDigitDecoderSBND               decoder;  ///< uncompresses the adc values
+      CandidateROIVec                         candROIVec;
+      std::vector<float>                      roiScratch; ///< scratch space of the ROI tool
+      util::ModeHistogramSBND                 baselineHist;
+    };
+
+    // What a channel needs from the services, looked up in the main thread.
+    struct ChannelJob {
+      const util::SignalShaping* shaping = nullptr;
+      int                        timeOffset = 0;
+    };
+
+    unsigned      fNThreads;          ///< threads sharing the channels of an event
+    std::vector<Workspace> fWorkspaces; ///< one per thread
+
     bool          fDoBaselineSub;     ///< subtract baseline to restore DC component post-deconvolution
     bool          fDoAdvBaselineSub;  ///< use interpolation-based baseline subtraction
     int           fBaseSampleBins;    ///< bin grouping size in "interpolate"  method
@@ -87,8 +111,11 @@ namespace caldata {
                               ///< it is set by the DigitModuleLabel
                               ///< ex.:  "daq:preSpill" for prespill data
     
-    void          SubtractBaseline(std::vector<float>& holder);
-    void          SubtractBaselineAdv(std::vector<float>& holder);
+    void          ProcessChannel(raw::RawDigit const& digit, ChannelJob const& job,
+                                 unsigned int dataSize, double DeconNorm, Workspace& ws,
+                                 recob::Wire::RegionsOfInterest_t& roiVec) const;
+    void          SubtractBaseline(std::vector<float>& holder, util::ModeHistogramSBND& hist) const;
+    void          SubtractBaselineAdv(std::vector<float>& holder) const;
     
 
   protected: 
@@ -125,6 +152,12 @@ namespace caldata {
     fDoAdvBaselineSub = p.get< bool >       ("DoAdvBaselineSub");
     fBaseSampleBins   = p.get< int >        ("BaseSampleBins");
     fBaseVarCut       = p.get< int >        ("BaseVarCut");
+    fNThreads         = util::ResolveNThreads(p.get< unsigned >("NThreads", 1),
+                                              "SBNDCODE_CALWIRE_NTHREADS", "CalWireSBND");
+    if ( fNThreads > 1 )
+      mf::LogInfo("CalWireSBND") << "Deconvoluting channels on " << fNThreads << " threads";
+    fWorkspaces.clear();
+    fWorkspaces.resize(fNThreads);
     
     fSpillName="";
     
@@ -144,6 +177,7 @@ namespace caldata {
   //////////////////////////////////////////////////////
   void CalWireSBND::endJob()
   {  
+    mf::LogInfo("CalWireSBND") << util::FFTPlanCacheSBND::Summary();
   }
   
   //////////////////////////////////////////////////////
@@ -197,83 +231,40 @@ namespace caldata {
       mf::LogError("CalWireSBND")<<"Set BaseSampleBins modulo dataSize= "<<dataSize;
     }
 
-    uint32_t     channel(0); // channel number
-    unsigned int bin(0);     // time bin loop variable
-    
-///    filter::ChannelFilter *chanFilt = new filter::ChannelFilter();  
-
-    std::vector<float> holder;                // holds signal data
-    std::vector<short> rawadc(transformSize);  // vector holding uncompressed adc values
-    std::vector<TComplex> freqHolder(transformSize+1); // temporary frequency data
-    
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataFor(evt);
 
-    // loop over all wires    
-    wirecol->reserve(digitVecHandle->size());
-    for(size_t rdIter = 0; rdIter < digitVecHandle->size(); ++rdIter){ // ++ move
-      holder.clear();
-      
-      // get the reference to the current raw::RawDigit
-      art::Ptr<raw::RawDigit> digitVec(digitVecHandle, rdIter);
-      channel = digitVec->Channel();
+    // the services are only used from this thread: the signal shaping is
+    // set up on first use
+    const size_t nDigits = digitVecHandle->size();
+    std::vector<ChannelJob> jobs(nDigits);
+    for(size_t rdIter = 0; rdIter < nDigits; ++rdIter){
+      uint32_t channel = (*digitVecHandle)[rdIter].Channel();
+      jobs[rdIter].shaping    = &sss->SignalShaping(channel);
+      jobs[rdIter].timeOffset = sss->FieldResponseTOffset(clockData, channel);
+    }
 
-      // skip bad channels
-      //  if(!chanFilt->BadChannel(channel)) {
-      if(true) {
+    // plans come from the SBND plan cache, not from the shared LArFFT state
+    for(unsigned worker = 0; worker < fWorkspaces.size(); ++worker){
+      Workspace& ws = fWorkspaces[worker];
+      if(!ws.fft || ws.fft->FFTSize() != transformSize)
+        ws.fft = std::make_unique<util::FFTWorkspaceSBND>(transformSize, fFFT->FFTOptions(),
+                                                          util::FFTPlanCacheSBND::kWorkerSlot + worker);
+    }
 
-        // resize and pad with zeros
-        holder.resize(transformSize, 0.);
-        
-        // uncompress the data
-        raw::Uncompress(digitVec->ADCs(), rawadc, digitVec->Compression());
-        
-        // loop over all adc values and subtract the pedestal
-        float pdstl = digitVec->GetPedestal();
-        
-        for(bin = 0; bin < dataSize; ++bin) 
-          holder[bin]=(rawadc[bin]-pdstl);
-
-	//fill the remaining bin with data
-	for(bin = dataSize; bin < holder.size(); bin++){
-	  //  philosophy change - don't repeat data but instead fill extra space with zeros.
-          //    not sure that one is better than the other.
-	  //	  holder[bin] = (rawadc[bin-dataSize]-pdstl);
-	  holder[bin] = 0.0;
-	}
-
-        // Do deconvolution.
-        sss->Deconvolute(clockData, channel, holder);
-	  for(bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
-      } // end if not a bad channel 
-      
-      holder.resize(dataSize,1e-5);
-
-      // restore DC component through baseline subtraction
-      if( fDoBaselineSub ) SubtractBaseline(holder);
-      // more advanced, interpolation-based subtraction alg 
-      // that uses the BaseSampleBins and BaseVarCut params
-      if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
-
-      // Make a single ROI that spans the entire data size
-      //RegionsOfInterest_t sparse_holder;
-      //sparse_holder.add_range(0,holder.begin(),holder.end());
-      CandidateROIVec candROIVec;
-      fROITool->FindROIs( holder, channel, candROIVec);//calculates ROI and returns it to roiVec.
-      //auto view = geom->View(channel);
-      recob::Wire::RegionsOfInterest_t roiVec;
-
-      //looping over roiVec to make a RegionOfInterest_t object.
-      for(auto const& CandidateROI: candROIVec){
-	size_t roiStart = CandidateROI.first;
-	size_t roiStop = CandidateROI.second;
-	std::vector<float> roiHolder;
-	for(size_t i_holder=roiStart; i_holder<=roiStop; i_holder++){
-	  roiHolder.push_back(holder[i_holder]);
-	}
-	roiVec.add_range(roiStart, std::move(roiHolder));
-      }
-      wirecol->push_back(recob::WireCreator(std::move(roiVec),*digitVec).move());
+    // the channels are shared out among the threads; the wires and their
+    // associations are then made in the order of the digits
+    std::vector<recob::Wire::RegionsOfInterest_t> roiVecs(nDigits);
+    util::ParallelForEach(fNThreads, nDigits, [&](size_t rdIter, unsigned worker) {
+      ProcessChannel((*digitVecHandle)[rdIter], jobs[rdIter], dataSize, DeconNorm,
+                     fWorkspaces[worker], roiVecs[rdIter]);
+    });
 
+    // loop over all wires    
+    wirecol->reserve(nDigits);
+    for(size_t rdIter = 0; rdIter < nDigits; ++rdIter){ // ++ move
+      // get the reference to the current raw::RawDigit
+      art::Ptr<raw::RawDigit> digitVec(digitVecHandle, rdIter);
+      wirecol->push_back(recob::WireCreator(std::move(roiVecs[rdIter]),*digitVec).move());
 
       // add an association between the last object in wirecol--Hec
       // (that we just inserted) and digitVec
@@ -300,7 +291,59 @@ namespace caldata {
   }
  
   
-  void CalWireSBND::SubtractBaseline(std::vector<float>& holder)
+  //////////////////////////////////////////////////////
+  // Deconvolute one channel and find its regions of interest; only the
+  // workspace of the calling thread and roiVec are written to.
+  void CalWireSBND::ProcessChannel(raw::RawDigit const& digit, ChannelJob const& job,
+                                   unsigned int dataSize, double DeconNorm, Workspace& ws,
+                                   recob::Wire::RegionsOfInterest_t& roiVec) const
+  {
+    unsigned int bin(0);     // time bin loop variable
+    uint32_t channel = digit.Channel();
+    std::vector<float>& holder = ws.holder;
+    const size_t transformSize = ws.fft->FFTSize();
+
+    holder.clear();
+
+    // skip bad channels
+    //  if(!chanFilt->BadChannel(channel)) {
+    if(true) {
+
+      // uncompress the data, subtract the pedestal and pad with zeros
+      // up to the transform size in one pass
+      //  philosophy change - don't repeat data but instead fill extra space with zeros.
+      //    not sure that one is better than the other.
+      ws.decoder.Decode(digit, digit.GetPedestal(), transformSize, holder);
+
+      // Do deconvolution.
+      util::SignalShapingServiceSBND::Deconvolute(*job.shaping, job.timeOffset, holder, *ws.fft);
+      for(bin = 0; bin < holder.size(); ++bin) holder[bin]=holder[bin]/DeconNorm;
+    } // end if not a bad channel
+
+    holder.resize(dataSize,1e-5);
+
+    // restore DC component through baseline subtraction
+    if( fDoBaselineSub ) SubtractBaseline(holder, ws.baselineHist);
+    // more advanced, interpolation-based subtraction alg
+    // that uses the BaseSampleBins and BaseVarCut params
+    if( fDoAdvBaselineSub ) SubtractBaselineAdv(holder);
+
+    CandidateROIVec& candROIVec = ws.candROIVec;
+    candROIVec.clear();
+    fROITool->FindROIs( holder, channel, candROIVec, ws.roiScratch);//calculates ROI and returns it to roiVec.
+
+    //looping over roiVec to make a RegionOfInterest_t object.
+    //The ROIs come padded and merged from the tool, so each one is copied
+    //once, straight from the deconvolved waveform, into a range allocated
+    //to its length.
+    for(auto const& CandidateROI: candROIVec){
+      size_t roiStart = CandidateROI.first;
+      size_t roiStop = CandidateROI.second;
+      roiVec.add_range(roiStart, holder.begin() + roiStart, holder.begin() + roiStop + 1);
+    }
+  }
+
+  void CalWireSBND::SubtractBaseline(std::vector<float>& holder, util::ModeHistogramSBND& hist) const
   {
     // Robust baseline calculation that effectively ignores outlier 
     // samples from large pulses:
@@ -316,9 +359,9 @@ namespace caldata {
     }
     int nbin = max - min;
     if (nbin > 0) {
-      TH1F h("h","h",nbin,min,max);
-      for(bin = 0; bin < holder.size(); bin++) h.Fill(holder[bin]);
-      float x_max = h.GetXaxis()->GetBinCenter(h.GetMaximumBin());
+      hist.Reset(nbin,min,max);
+      for(bin = 0; bin < holder.size(); bin++) hist.Fill(holder[bin]);
+      float x_max = hist.Mode();
       float ped   = x_max;
       float sum   = 0;
       int ncount  = 0;
@@ -333,7 +376,7 @@ namespace caldata {
     }
   }
  
-  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder)
+  void CalWireSBND::SubtractBaselineAdv(std::vector<float>& holder) const
   {
       // Subtract baseline using linear interpolation between regions defined
       // by the datasize and fBaseSampleBins
@@ -35,8 +35,9 @@ namespace sbnd_tool
       using CandidateROI    = std::pair<size_t, size_t>;
       using CandidateROIVec = std::vector<CandidateROI>;
         
-      // Find the ROI's
-      virtual void FindROIs(const Waveform&, size_t, CandidateROIVec&) const = 0;
+      // Find the ROI's; the last waveform is scratch space owned by the caller,
+      // one per calling thread, which the tool may resize and overwrite
+      virtual void FindROIs(const Waveform&, size_t, CandidateROIVec&, Waveform&) const = 0;
     };
 }
 #endif
@@ -29,9 +29,17 @@ namespace sbnd_tool
     void   configure(const fhicl::ParameterSet& pset)                        override;
     void   initializeHistograms(art::TFileDirectory&)                  const override;
     size_t plane()                                                   const override {return fPlane;}
-    void   FindROIs(const Waveform&, size_t, CandidateROIVec&) const override;
-    double calculateLocalRMS(const Waveform& waveform) const;
+    void   FindROIs(const Waveform&, size_t, CandidateROIVec&, Waveform&) const override;
+    double calculateLocalRMS(const Waveform& waveform, Waveform& locWaveform) const;
   private:
+    // Plane and thresholds of a channel, filled for all the channels at configuration
+    struct ChannelThreshold
+    {
+      size_t plane;                                      ///< plane of the channel
+      float  elecNoise;                                  ///< electronics noise
+      float  startThreshold;                             ///< running sum threshold with the electronics noise
+    };
+    
     // Member variables from the fhicl file
     size_t                        fPlane;
     float                fNumBinsHalf;                ///< Determines # bins in ROI running sum
@@ -39,6 +47,7 @@ namespace sbnd_tool
     std::vector<int>              fNumSigma;                   ///< "# sigma" rms noise for ROI threshold
     std::vector<float>   fPreROIPad;                  ///< ROI padding
     std::vector<float>   fPostROIPad;                 ///< ROI padding
+    std::vector<ChannelThreshold> fChannelThresholds;  ///< by channel
     
     // Services
     const geo::GeometryCore*                             fGeometry = lar::providerFrom<geo::Geometry>();
@@ -89,26 +98,50 @@ namespace sbnd_tool
     // Get signal shaping service.
     sss = art::ServiceHandle<util::SignalShapingServiceSBND>();
     
+    // The plane and the electronics noise of a channel do not change, so
+    // they are looked up once here rather than for every waveform
+    size_t numBins(2 * fNumBinsHalf + 1);
+    
+    fChannelThresholds.resize(fGeometry->Nchannels());
+    for(size_t channel = 0; channel < fChannelThresholds.size(); channel++)
+      {
+        ChannelThreshold& thresholds = fChannelThresholds[channel];
+        std::vector<geo::WireID> wids = fGeometry->ChannelToWire(channel);
+        
+        thresholds.plane          = wids[0].planeID().Plane;
+        thresholds.elecNoise      = sss->GetRawNoise(channel);
+        thresholds.startThreshold = sqrt(float(numBins)) * (fNumSigma[thresholds.plane] * thresholds.elecNoise + fThreshold[thresholds.plane]);
+      }
+    
     return;
   }
     
   //void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, size_t cnt, double rmsNoise, CandidateROIVec& roiVec) const
-  void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, CandidateROIVec& roiVec) const
+  void ROIFinderStandardSBND::FindROIs(const Waveform& waveform, size_t channel, CandidateROIVec& roiVec, Waveform& scratch) const
   {
     // First up, translate the channel to plane
-    std::vector<geo::WireID> wids    = fGeometry->ChannelToWire(channel);
-    const geo::PlaneID&      planeID = wids[0].planeID();
+    if (channel >= fChannelThresholds.size()) {
+      throw cet::exception("ROIFinderStandardSBND")
+        << "Channel " << channel << " not in the geometry (" << fChannelThresholds.size() << " channels)\n";
+    }
+    const ChannelThreshold& thresholds = fChannelThresholds[channel];
+    const size_t            plane      = thresholds.plane;
     
     size_t numBins(2 * fNumBinsHalf + 1);
     size_t startBin(0);
     size_t stopBin(numBins);
-    float  elecNoise = sss->GetRawNoise(channel);
-
-    double rmsNoise = this->calculateLocalRMS(waveform); // added from ICARUS calculation.
-
-    float  rawNoise  = std::max(rmsNoise, double(elecNoise));
     
-    float startThreshold = sqrt(float(numBins)) * (fNumSigma[planeID.Plane] * rawNoise + fThreshold[planeID.Plane]);
+    float startThreshold = thresholds.startThreshold;
+    
+    // the local RMS only matters when the threshold is in sigma of the noise
+    if (fNumSigma[plane] != 0)
+      {
+        double rmsNoise = this->calculateLocalRMS(waveform, scratch); // added from ICARUS calculation.
+        
+        float  rawNoise  = std::max(rmsNoise, double(thresholds.elecNoise));
+        
+        startThreshold = sqrt(float(numBins)) * (fNumSigma[plane] * rawNoise + fThreshold[plane]);
+      }
     float stopThreshold  = startThreshold;
     
     // Setup
@@ -153,65 +186,50 @@ namespace sbnd_tool
     // add the last ROI if existed
     if (roiCandStart) roiVec.push_back(CandidateROI(roiStartBin, waveform.size() - 1));
     
-    // pad the ROIs
-    for(auto& roi : roiVec)
+    // pad the ROIs and merge the overlapping (or touching) ones, in place;
+    // the ROIs come in order, so a padded ROI can only overlap the last
+    // merged one
+    size_t nMerged = 0;
+    for(auto const& candidate : roiVec)
       {
+        CandidateROI roi(candidate);
         // low ROI end
-        roi.first  = std::max(int(roi.first - fPreROIPad[planeID.Plane]),0);
+        roi.first  = std::max(int(roi.first - fPreROIPad[plane]),0);
         // high ROI end
-        roi.second = std::min(roi.second + fPostROIPad[planeID.Plane], float(waveform.size()) - 1);
-      }
-    
-    // merge overlapping (or touching) ROI's
-    if(roiVec.size() > 1)
-      {
-        // temporary vector for merged ROIs
-        CandidateROIVec tempRoiVec;
-        
-        // Loop through candidate roi's
-        size_t startRoi = roiVec.front().first;
-        size_t stopRoi  = startRoi;
-        
-        for(auto& roi : roiVec)
-	  {
-            if (roi.first <= stopRoi) stopRoi = roi.second;
-            else
-	      {
-                tempRoiVec.push_back(CandidateROI(startRoi,stopRoi));
-                
-                startRoi = roi.first;
-                stopRoi  = roi.second;
-	      }
-	  }
-        
-        // Make sure to get the last one
-        tempRoiVec.push_back(CandidateROI(startRoi,stopRoi));
-        
-        roiVec = tempRoiVec;
+        roi.second = std::min(roi.second + fPostROIPad[plane], float(waveform.size()) - 1);
+
+        if (nMerged > 0 && roi.first <= roiVec[nMerged - 1].second) roiVec[nMerged - 1].second = roi.second;
+        else roiVec[nMerged++] = roi;
       }
+    roiVec.resize(nMerged);
     
     return;
   }
 
 
-  double ROIFinderStandardSBND::calculateLocalRMS(const Waveform& waveform) const
+  double ROIFinderStandardSBND::calculateLocalRMS(const Waveform& waveform, Waveform& locWaveform) const
   {
-    // do rms calculation - the old fashioned way and over all adc values                                                                                            
-    std::vector<float> locWaveform = waveform;
-
-    // sort in ascending order so we can truncate the sume                                                                                                           
-    std::sort(locWaveform.begin(), locWaveform.end(),[](const auto& left, const auto& right){return std::fabs(left) < std::fabs(right);});
+    // do rms calculation - the old fashioned way and over the half of the adc values
+    // closest to 0; the copy of the waveform goes in the scratch buffer of the caller
+    locWaveform.assign(waveform.begin(), waveform.end());
 
-    // Get the mean of the waveform we're checking...                                                                                                                
-    float sumWaveform  = std::accumulate(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2, 0.);
-    float meanWaveform = sumWaveform / float(locWaveform.size()/2);
+    // only the smallest half is needed to truncate the sum, not its order
+    const size_t halfSize = locWaveform.size()/2;
+    std::nth_element(locWaveform.begin(), locWaveform.begin() + halfSize, locWaveform.end(),
+                     [](const auto& left, const auto& right){return std::fabs(left) < std::fabs(right);});
 
-    std::vector<float> locWaveformDiff(locWaveform.size()/2);
-    std::transform(locWaveform.begin(),locWaveform.begin() + locWaveform.size()/2,locWaveformDiff.begin(), std::bind(std::minus<float>(),std::placeholders::_1,meanWaveform));
+    // Get the mean of the waveform we're checking...
+    float sumWaveform  = std::accumulate(locWaveform.begin(),locWaveform.begin() + halfSize, 0.);
+    float meanWaveform = sumWaveform / float(halfSize);
 
-    double localRMS = std::inner_product(locWaveformDiff.begin(), locWaveformDiff.end(), locWaveformDiff.begin(), 0.);
+    double localRMS = 0.;
+    for(size_t i = 0; i < halfSize; i++)
+      {
+        const float diff = locWaveform[i] - meanWaveform;
+        localRMS += diff * diff;
+      }
 
-    localRMS = std::sqrt(std::max(float(0.),float(localRMS) / float(locWaveformDiff.size())));
+    localRMS = std::sqrt(std::max(float(0.),float(localRMS) / float(halfSize)));
     
     return(localRMS);
 
@@ -45,6 +45,7 @@
 #include "sbnobj/Common/CRT/CRTTrack.hh"
 #include "sbndcode/CRT/CRTUtils/CRTHitRecoAlg.h"
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/Utilities/RawDigitUtilsSBND.h"
 #include "sbnobj/SBND/Commissioning/MuonTrack.hh"
 
 
@@ -923,6 +924,9 @@ void Hitdumper::analyze(const art::Event& evt)
     int adc_counter = 1;
     _adc_count = _nhits * (fWindow * 2 + 1);
 
+    util::RawDigitDecoderSBND decoder;
+    std::vector<float> adcs;        //UNCOMPRESSED ADC VALUES, PEDESTAL SUBTRACTED.
+
     // loop over waveforms
     for(size_t rdIter = 0; rdIter < digitVecHandle->size(); ++rdIter) {
 
@@ -930,20 +934,17 @@ void Hitdumper::analyze(const art::Event& evt)
       art::Ptr<raw::RawDigit> digitVec(digitVecHandle, rdIter);
       int channel   = digitVec->Channel();
       auto fDataSize = digitVec->Samples();
-      std::vector<short> rawadc;      //UNCOMPRESSED ADC VALUES.
-      rawadc.resize(fDataSize);
+      bool decoded = false;
 
       // see if there is a hit on this channel
       for (int ihit = 0; ihit < _nhits; ++ihit) {
         if (_hit_channel[ihit] == channel) {
 
           int pedestal = (int)digitVec->GetPedestal();
-          //UNCOMPRESS THE DATA.
-          if (fUncompressWithPed) {
-            raw::Uncompress(digitVec->ADCs(), rawadc, pedestal, digitVec->Compression());
-          }
-          else {
-            raw::Uncompress(digitVec->ADCs(), rawadc, digitVec->Compression());
+          //UNCOMPRESS THE DATA, ONCE FOR ALL THE HITS OF THE CHANNEL.
+          if (!decoded) {
+            decoder.Decode(*digitVec, pedestal, 0, adcs, fUncompressWithPed);
+            decoded = true;
           }
 
           unsigned int bin = _hit_peakT[ihit];
@@ -968,7 +969,7 @@ void Hitdumper::analyze(const art::Event& evt)
             _adc_count_in_waveform[adc_counter] = counter_for_adc_in_waveform;
             counter_for_adc_in_waveform++;
             _waveform_number[adc_counter] = waveform_number_tracker;
-            _adc_on_wire[adc_counter] = rawadc[ibin]-pedestal;
+            _adc_on_wire[adc_counter] = adcs[ibin];
             _time_for_waveform[adc_counter] = ibin;
             //std::cout << "DUMP: " << _waveform_number[adc_counter] << " " << _adc_count << " " << _hit_plane[ihit] << " " << _hit_wire[ihit] << " " <<ibin << " " << (rawadc[ibin]-pedestal) << " " << _time_for_waveform[adc_counter] << " " << _adc_on_wire[adc_counter] << std::endl;
             integral+=_adc_on_wire[adc_counter];
@@ -0,0 +1,104 @@
+// BatchedNoiseSBND.h
+//
+// Frequency-domain noise synthesis for a block of waveforms at a time.
+//
+// The random numbers come from a stateless counter-based generator keyed by
+// (seed, stream, counter) instead of a sequential engine: the loops over the
+// frequency bins have no dependency between iterations and vectorise, and the
+// noise of a stream (e.g. a channel) only depends on the seed and on the
+// stream number, not on which block it was made in or in which order.
+// Amplitudes and phases are kept as separate float arrays and all the
+// waveforms of a block go through the same FFT plan.
+//
+// The spectra are statistically the same as the ones of the sequential
+// generation in the services, but not the same numbers.
+
+#ifndef BatchedNoiseSBND_H
+#define BatchedNoiseSBND_H
+
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sbnd {
+
+class BatchedNoiseSBND {
+
+public:
+
+  BatchedNoiseSBND(size_t nTicks, std::string const& fftOption = "")
+    : fNTicks(nTicks), fNBins(nTicks/2 + 1), fFFT(nTicks, fftOption),
+      fRnd0(fNBins), fRnd1(fNBins), fRe(fNBins), fIm(fNBins), fWave(nTicks) {}
+
+  size_t NTicks() const { return fNTicks; }
+  size_t NBins()  const { return fNBins; }
+
+  // Uniform number in [0, 1) for (seed, stream, counter), from a splitmix64
+  // hash of the three.
+  static float Uniform(uint64_t seed, uint64_t stream, uint64_t counter) {
+    uint64_t z = seed + stream*0x9E3779B97F4A7C15ULL + counter*0xD1B54A32D192ED03ULL;
+    z = (z ^ (z >> 30))*0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27))*0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 40)*(1.f/16777216.f);
+  }
+
+  // Add to *outputs[j] the noise of streams[j] scaled by scales[j]. Bin i of
+  // the spectrum has amplitude shape[i]*((1 - randomFraction) + 2*randomFraction*u)
+  // and a uniform phase, u being uniform in [0, 1); the waveform is the
+  // inverse transform normalised by 1/NTicks() as util::LArFFT does.
+  template <class T>
+  void Synthesize(std::vector<float> const& shape, float randomFraction, uint64_t seed,
+                  std::vector<uint64_t> const& streams, std::vector<double> const& scales,
+                  std::vector<std::vector<T>*> const& outputs) {
+    const float twoPi = 2.f*M_PI;
+    const float fixed = 1.f - randomFraction;
+    const float varying = 2.f*randomFraction;
+    float* rnd0 = fRnd0.data();
+    float* rnd1 = fRnd1.data();
+    float* re = fRe.data();
+    float* im = fIm.data();
+    float const* amp = shape.data();
+
+    for (size_t j = 0; j < streams.size(); ++j) {
+      const uint64_t stream = streams[j];
+      for (size_t i = 0; i < fNBins; ++i) {
+        rnd0[i] = Uniform(seed, stream, 2*i);
+        rnd1[i] = Uniform(seed, stream, 2*i + 1);
+      }
+      for (size_t i = 0; i < fNBins; ++i) {
+        const float a = amp[i]*(fixed + varying*rnd0[i]);
+        const float phase = twoPi*rnd1[i];
+        re[i] = a*std::cos(phase);
+        im[i] = a*std::sin(phase);
+      }
+
+      fFFT.DoInvFFT(re, im, fWave);
+
+      std::vector<T>& out = *outputs[j];
+      const double scale = scales[j];
+      const size_t n = std::min(out.size(), fNTicks);
+      for (size_t t = 0; t < n; ++t) out[t] += scale*fWave[t];
+    }
+  }
+
+private:
+
+  size_t                 fNTicks;
+  size_t                 fNBins;
+  util::FFTWorkspaceSBND fFFT;
+  std::vector<float>     fRnd0;  ///< amplitude randomisation of each bin
+  std::vector<float>     fRnd1;  ///< phase of each bin
+  std::vector<float>     fRe;
+  std::vector<float>     fIm;
+  std::vector<double>    fWave;
+
+};
+
+} // namespace sbnd
+
+#endif
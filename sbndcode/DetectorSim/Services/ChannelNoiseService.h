@@ -27,6 +27,16 @@ public:
   // Noise is added for all entries in the input vector.
   virtual int addNoise(detinfo::DetectorClocksData const&, Channel chan, AdcSignalVector& sigs) const =0;
 
+  // Add noise to the signal vectors of a block of channels, *sigs[i] for chans[i].
+  // The default adds the noise of each channel in turn with addNoise().
+  virtual int addNoiseBlock(detinfo::DetectorClocksData const& clockData,
+                            std::vector<Channel> const& chans,
+                            std::vector<AdcSignalVector*> const& sigs) const {
+    int status = 0;
+    for (size_t i = 0; i < chans.size(); ++i) status |= addNoise(clockData, chans[i], *sigs[i]);
+    return status;
+  }
+
   virtual void generateNoise(detinfo::DetectorClocksData const&){
     return;
   }
@@ -0,0 +1,142 @@
+// NoiseBankSBND.h
+//
+// A fixed set of noise waveforms made once per job, from which the noise
+// services take a random entry read from a random cyclic offset for each
+// channel, instead of synthesising a new waveform with an inverse FFT.
+//
+// A bank holds one or more components: a service whose spectrum is a linear
+// combination of a few fixed shapes stores one waveform per shape for each
+// entry, all made from the same random amplitudes and phases, and scales
+// them per channel.
+//
+// Banks can be written to the histogram file and read back in a later job;
+// each component is a TH2F named "<name>_<component>" with ticks on x and
+// entries on y.
+
+#ifndef NoiseBankSBND_H
+#define NoiseBankSBND_H
+
+#include "art/Framework/Services/Registry/ServiceHandle.h"
+#include "art_root_io/TFileService.h"
+#include "cetlib/search_path.h"
+#include "cetlib_except/exception.h"
+
+#include "CLHEP/Random/RandFlat.h"
+#include "CLHEP/Random/RandomEngine.h"
+
+#include "TFile.h"
+#include "TH2.h"
+#include "TH2F.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace sbnd {
+
+class NoiseBankSBND {
+
+public:
+
+  // Which entry a channel reads, and from which tick.
+  struct Draw {
+    size_t entry  = 0;
+    size_t offset = 0;
+  };
+
+  NoiseBankSBND() = default;
+
+  NoiseBankSBND(size_t nComponents, size_t nEntries, size_t nTicks)
+    : fNEntries(nEntries), fNTicks(nTicks),
+      fWaveforms(nComponents, std::vector<float>(nEntries*nTicks, 0.)) {}
+
+  bool   empty()       const { return fWaveforms.empty() || fNEntries == 0 || fNTicks == 0; }
+  size_t NComponents() const { return fWaveforms.size(); }
+  size_t NEntries()    const { return fNEntries; }
+  size_t NTicks()      const { return fNTicks; }
+
+  // First sample of one waveform; the NTicks() samples are contiguous.
+  float*       Waveform(size_t component, size_t entry)       { return &fWaveforms[component][entry*fNTicks]; }
+  float const* Waveform(size_t component, size_t entry) const { return &fWaveforms[component][entry*fNTicks]; }
+
+  // Random entry and cyclic offset, two flat draws from engine.
+  Draw Pick(CLHEP::HepRandomEngine& engine) const {
+    CLHEP::RandFlat flat(engine);
+    Draw draw;
+    draw.entry  = std::min(fNEntries - 1, (size_t) (flat.fire()*fNEntries));
+    draw.offset = std::min(fNTicks - 1,   (size_t) (flat.fire()*fNTicks));
+    return draw;
+  }
+
+  // sigs[t] += scale*waveform[(t + offset) % NTicks()]
+  template <class T>
+  void Add(size_t component, Draw const& draw, double scale, std::vector<T>& sigs) const {
+    float const* wf = Waveform(component, draw.entry);
+    size_t t = 0;
+    while (t < sigs.size()) {
+      const size_t first = (t + draw.offset) % fNTicks;
+      const size_t n = std::min(sigs.size() - t, fNTicks - first);
+      for (size_t i = 0; i < n; ++i) sigs[t+i] += scale*wf[first+i];
+      t += n;
+    }
+  }
+
+  // Read a bank written by Save() from a file on FW_SEARCH_PATH.
+  void Load(std::string const& fileName, std::string const& name, size_t nComponents) {
+    std::string path;
+    cet::search_path sp("FW_SEARCH_PATH");
+    if ( !sp.find_file(fileName, path) )
+      throw cet::exception("NoiseBankSBND") << "Could not find noise bank file '" << fileName << "'\n";
+
+    TFile in(path.c_str(), "READ");
+    if ( !in.IsOpen() )
+      throw cet::exception("NoiseBankSBND") << "Could not open noise bank file '" << path << "'\n";
+
+    fWaveforms.clear();
+    for (size_t c = 0; c < nComponents; ++c) {
+      const std::string hname = name + "_" + std::to_string(c);
+      TH2* h = (TH2*) in.Get(hname.c_str());
+      if ( !h )
+        throw cet::exception("NoiseBankSBND") << "Could not find noise bank histogram '" << hname
+                                              << "' in '" << path << "'\n";
+      if ( c == 0 ) {
+        fNTicks   = h->GetNbinsX();
+        fNEntries = h->GetNbinsY();
+      }
+      else if ( (size_t) h->GetNbinsX() != fNTicks || (size_t) h->GetNbinsY() != fNEntries )
+        throw cet::exception("NoiseBankSBND") << "Noise bank histogram '" << hname
+                                              << "' has a different size from the first component\n";
+
+      fWaveforms.emplace_back(fNEntries*fNTicks, 0.);
+      for (size_t e = 0; e < fNEntries; ++e) {
+        float* wf = Waveform(c, e);
+        for (size_t t = 0; t < fNTicks; ++t) wf[t] = h->GetBinContent(t+1, e+1);
+      }
+    }
+    in.Close();
+  }
+
+  // Write the bank to the histogram file, in the format read by Load().
+  void Save(std::string const& name) const {
+    art::ServiceHandle<art::TFileService> tfs;
+    for (size_t c = 0; c < NComponents(); ++c) {
+      const std::string hname = name + "_" + std::to_string(c);
+      TH2F* h = tfs->make<TH2F>(hname.c_str(), ";Tick;Entry", fNTicks, 0, fNTicks, fNEntries, 0, fNEntries);
+      for (size_t e = 0; e < fNEntries; ++e) {
+        float const* wf = Waveform(c, e);
+        for (size_t t = 0; t < fNTicks; ++t) h->SetBinContent(t+1, e+1, wf[t]);
+      }
+    }
+  }
+
+private:
+
+  size_t fNEntries = 0;
+  size_t fNTicks   = 0;
+  std::vector<std::vector<float>> fWaveforms;  ///< entries back to back, per component
+
+};
+
+} // namespace sbnd
+
+#endif
@@ -12,6 +12,8 @@
 #define SBNDThermalNoiseServiceInFreq_H
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/Services/NoiseBankSBND.h"
+#include "sbndcode/DetectorSim/Services/BatchedNoiseSBND.h"
 
 #include "CLHEP/Random/RandFlat.h"
 #include "CLHEP/Random/RandGaussQ.h"
@@ -33,7 +35,10 @@
 #include "TRandom3.h"
 #include "TF1.h"
 #include "TMath.h"
+#include "TComplex.h"
 
+#include <cstdint>
+#include <memory>
 #include <sstream>
 #include <vector>
 #include <iostream>
@@ -61,10 +66,28 @@ public:
   int addNoise(detinfo::DetectorClocksData const& clockData,
                Channel chan, AdcSignalVector& sigs) const override;
 
+  // Add noise to a block of signal arrays in one go (BatchedNoise only).
+  int addNoiseBlock(detinfo::DetectorClocksData const& clockData,
+                    std::vector<Channel> const& chans,
+                    std::vector<AdcSignalVector*> const& sigs) const override;
+
+  // Draw the seed of the batched noise for the next event.
+  void generateNoise(detinfo::DetectorClocksData const& clockData) override;
+
   // Print the configuration.
   std::ostream& print(std::ostream& out =std::cout, std::string prefix ="") const override;
 
 private:
+
+  // Scale of the noise spectrum of a channel.
+  double noiseFactor(Channel chan) const;
+
+  // Random noise spectrum with unit scale, drawing two flat numbers per bin.
+  void fillNoiseSpectrum(CLHEP::RandFlat& flat, size_t nTicks,
+                         std::vector<TComplex>& noiseFrequency) const;
+
+  // Fill fNoiseBank, either from fNoiseBankFile or by generating it.
+  void buildNoiseBank();
  
   // General parameters
   unsigned int            fNoiseArrayPoints; ///< number of points in randomly generated noise array
@@ -75,6 +98,18 @@ private:
   double                  fNoiseWidth;       ///< exponential noise width (kHz)
   double                  fNoiseRand;        ///< fraction of random "wiggle" in noise in freq. spectrum
   double                  fLowCutoff;        ///< low frequency filter cutoff (kHz)
+
+  // Noise bank
+  bool                    fUseNoiseBank;     ///< take noise from fNoiseBank instead of an FFT per channel
+  std::string             fNoiseBankFile;    ///< file to read the bank from; generated if empty
+  bool                    fSaveNoiseBank;    ///< write a generated bank to the histogram file
+  sbnd::NoiseBankSBND     fNoiseBank;        ///< NoiseArrayPoints waveforms with unit scale
+
+  // Batched noise
+  bool                    fBatchedNoise;     ///< synthesise with BatchedNoiseSBND, seeded per event and channel
+  uint64_t                fBatchSeed;        ///< seed of the current event
+  std::vector<float>      fBatchShape;       ///< spectrum with unit scale, before randomisation
+  mutable std::unique_ptr<sbnd::BatchedNoiseSBND> fBatchedSynth;
   
   //Declare noise engines.
   CLHEP::HepRandomEngine* m_pran;
@@ -19,7 +19,7 @@ using CLHEP::HepJamesRandom;
 
 SBNDThermalNoiseServiceInFreq::
 SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
-  : fRandomSeed(0), fLogLevel(1),  m_pran(nullptr), fNoiseEngine(nullptr)
+  : fRandomSeed(0), fLogLevel(1),  m_pran(nullptr), fNoiseEngine(nullptr), fBatchSeed(0)
 {
   const string myname = "SBNDThermalNoiseServiceInFreq::ctor: ";
   fNoiseArrayPoints  = pset.get<unsigned int>("NoiseArrayPoints");
@@ -31,6 +31,11 @@ SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
   fNoiseRand         = pset.get< double              >("NoiseRand");
   fLowCutoff         = pset.get< double              >("LowCutoff");
 
+  fUseNoiseBank      = pset.get< bool                >("UseNoiseBank", false);
+  fNoiseBankFile     = pset.get< std::string         >("NoiseBankFile", "");
+  fSaveNoiseBank     = pset.get< bool                >("SaveNoiseBank", false);
+  fBatchedNoise      = pset.get< bool                >("BatchedNoise", false);
+
 
   if ( fRandomSeed == 0 ) haveSeed = false;
   pset.get_if_present<int>("LogLevel", fLogLevel);
@@ -49,6 +54,7 @@ SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
   }
   if ( fLogLevel > 0 ) cout << myname << "  Registered seed: " << m_pran->getSeed() << endl;
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
+  fSampleRate = sampling_rate(clockData);
   generateNoise(clockData);
   if ( fLogLevel > 1 ) print() << endl;
 }
@@ -56,8 +62,11 @@ SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset)
 //**********************************************************************
 
 SBNDThermalNoiseServiceInFreq::
-SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset, art::ActivityRegistry&)
-: SBNDThermalNoiseServiceInFreq(pset) { }
+SBNDThermalNoiseServiceInFreq(fhicl::ParameterSet const& pset, art::ActivityRegistry& reg)
+: SBNDThermalNoiseServiceInFreq(pset) {
+  // the noise engine is only available once the producer is constructed
+  if ( fUseNoiseBank ) reg.sPostBeginJob.watch(this, &SBNDThermalNoiseServiceInFreq::buildNoiseBank);
+}
 
 //**********************************************************************
 
@@ -71,15 +80,118 @@ SBNDThermalNoiseServiceInFreq::~SBNDThermalNoiseServiceInFreq() {
 
 //**********************************************************************
 
-int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
+int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const& clockData,
                                             Channel chan, AdcSignalVector& sigs) const {
 
+  art::ServiceHandle<util::LArFFT> fFFT;
+  size_t fNTicks = fFFT->FFTSize();
+
+  double noise_factor = noiseFactor(chan);
+
+  if (sigs.size() != fNTicks)
+    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+        << "\033[93m"
+        << "Frequency noise vector length must match fNTicks (FFT size)"
+        << " ... " << sigs.size() << " != " << fNTicks
+        << "\033[00m"
+        << std::endl;
+
+  // noise bank: a random waveform from a random tick
+  if ( fUseNoiseBank ) {
+    fNoiseBank.Add(0, fNoiseBank.Pick(*fNoiseEngine), noise_factor, sigs);
+    return 0;
+  }
+
+  // batched synthesis, one channel
+  if ( fBatchedNoise ) return addNoiseBlock(clockData, { chan }, { &sigs });
+
+  CLHEP::RandFlat flat(*fNoiseEngine, -1, 1);
+
+  // noise in frequency space
+  std::vector<TComplex> noiseFrequency(fNTicks / 2 + 1, 0.);
+  fillNoiseSpectrum(flat, fNTicks, noiseFrequency);
+
+  // inverse FFT MCSignal
+  util::FFTWorkspaceSBND fft(fNTicks, fFFT->FFTOptions());
+  fft.DoInvFFT(noiseFrequency, sigs);
+
+  noiseFrequency.clear();
+
+  // multiply each noise value by fNTicks as the InvFFT
+   // divides each bin by fNTicks assuming that a forward FFT
+  // has already been done.
+  for (unsigned int i = 0; i < sigs.size(); ++i) {
+    sigs.at(i) *= noise_factor*fNTicks;
+  }
+  
+  return 0;
+}
+
+//**********************************************************************
+
+int SBNDThermalNoiseServiceInFreq::addNoiseBlock(detinfo::DetectorClocksData const& clockData,
+                                                 std::vector<Channel> const& chans,
+                                                 std::vector<AdcSignalVector*> const& sigs) const {
+
+  if ( !fBatchedNoise || fUseNoiseBank )
+    return ChannelNoiseService::addNoiseBlock(clockData, chans, sigs);
+
+  art::ServiceHandle<util::LArFFT> fFFT;
+  size_t fNTicks = fFFT->FFTSize();
+
+  if ( fBatchShape.size() != fNTicks / 2 + 1 )
+    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+      << "Batched noise requested before generateNoise() for FFT size " << fNTicks << std::endl;
+  if ( !fBatchedSynth || fBatchedSynth->NTicks() != fNTicks )
+    fBatchedSynth = std::make_unique<sbnd::BatchedNoiseSBND>(fNTicks, fFFT->FFTOptions());
+
+  std::vector<uint64_t> streams(chans.begin(), chans.end());
+  std::vector<double> scales(chans.size());
+  for (size_t i = 0; i < chans.size(); ++i) {
+    if (sigs[i]->size() != fNTicks)
+      throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+          << "Frequency noise vector length must match fNTicks (FFT size)"
+          << " ... " << sigs[i]->size() << " != " << fNTicks << std::endl;
+    // InvFFT divides by fNTicks, as in addNoise()
+    scales[i] = noiseFactor(chans[i])*fNTicks;
+  }
+
+  fBatchedSynth->Synthesize(fBatchShape, fNoiseRand, fBatchSeed, streams, scales, sigs);
+  return 0;
+}
+
+//**********************************************************************
+
+void SBNDThermalNoiseServiceInFreq::generateNoise(detinfo::DetectorClocksData const&) {
+
+  // also called from the constructor, before the producer made the engine
+  if ( !fBatchedNoise || fUseNoiseBank || !fNoiseEngine ) return;
+
+  // one seed per event from the noise engine; each channel is then its own stream
+  fBatchSeed = (uint64_t(static_cast<unsigned int>(*fNoiseEngine)) << 32)
+             | static_cast<unsigned int>(*fNoiseEngine);
+
+  art::ServiceHandle<util::LArFFT> fFFT;
+  size_t fNTicks = fFFT->FFTSize();
+  if ( fBatchShape.size() == fNTicks / 2 + 1 ) return;
+
+  // same spectrum as fillNoiseSpectrum(), before randomisation
+  double binWidth = 1.0 / (fNTicks * fSampleRate * 1.0e-6);
+  fBatchShape.resize(fNTicks / 2 + 1);
+  for (size_t i = 0; i < fBatchShape.size(); ++i) {
+    double lofilter = 1.0 / (1.0 + exp(-(i - fLowCutoff / binWidth) / 0.5));
+    fBatchShape[i] = exp(-(double)i * binWidth / fNoiseWidth) * lofilter;
+  }
+}
+
+//**********************************************************************
+
+double SBNDThermalNoiseServiceInFreq::noiseFactor(Channel chan) const {
+
   //Get services.
   art::ServiceHandle<geo::Geometry> geo;
   art::ServiceHandle<util::SignalShapingServiceSBND> sss;
-  art::ServiceHandle<util::LArFFT> fFFT;
-  
-  //Generate Noise:
+
   size_t view = (size_t)geo->View(chan);
   
   double noise_factor;
@@ -87,9 +199,6 @@ int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
   double shapingTime = 2.0; //sss->GetShapingTime(chan);
   double asicGain = sss->GetASICGain(chan);
 
-  size_t fNTicks = fFFT->FFTSize();
-
-  
   if (fShapingTimeOrder.find( shapingTime ) != fShapingTimeOrder.end() ) {
     noise_factor = tempNoiseVec[view].at( fShapingTimeOrder.find( shapingTime )->second );
     noise_factor *= asicGain/4.7;
@@ -103,21 +212,13 @@ int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
       << "\033[00m"
       << std::endl;
   }
+  return noise_factor;
+}
 
-  
-  CLHEP::RandFlat flat(*fNoiseEngine, -1, 1);
-
-
-  if (sigs.size() != fNTicks)
-    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
-        << "\033[93m"
-        << "Frequency noise vector length must match fNTicks (FFT size)"
-        << " ... " << sigs.size() << " != " << fNTicks
-        << "\033[00m"
-        << std::endl;
+//**********************************************************************
 
-  // noise in frequency space
-  std::vector<TComplex> noiseFrequency(fNTicks / 2 + 1, 0.);
+void SBNDThermalNoiseServiceInFreq::fillNoiseSpectrum(CLHEP::RandFlat& flat, size_t nTicks,
+                                                      std::vector<TComplex>& noiseFrequency) const {
 
   double pval = 0.;
   double lofilter = 0.;
@@ -125,59 +226,64 @@ int SBNDThermalNoiseServiceInFreq::addNoise(detinfo::DetectorClocksData const&,
   double rnd[2] = {0.};
 
   // width of frequencyBin in kHz
-  double binWidth = 1.0 / (fNTicks * fSampleRate * 1.0e-6);
+  double binWidth = 1.0 / (nTicks * fSampleRate * 1.0e-6);
 
-  for (size_t i = 0; i < fNTicks / 2 + 1; ++i) {
+  for (size_t i = 0; i < nTicks / 2 + 1; ++i) {
     // exponential noise spectrum
     flat.fireArray(2, rnd, 0, 1);
-    std::cout << "rnd[0]: " << rnd[0] << std::endl;
-    std::cout << "rnd[1]: " << rnd[1] << std::endl;
 
-    pval = noise_factor * exp(-(double)i * binWidth / fNoiseWidth);
+    pval = exp(-(double)i * binWidth / fNoiseWidth);
     // low frequency cutoff
     lofilter = 1.0 / (1.0 + exp(-(i - fLowCutoff / binWidth) / 0.5));
     // randomize 10%
 
     pval *= lofilter * ((1 - fNoiseRand) + 2 * fNoiseRand * rnd[0]);
 
-    /*
-    //if not from histo or in time --> then hardcoded freq. spectrum
-    if ( !fGetNoiseFromHisto )
-    {
-      pval = noise_factor * exp(-(double)i * binWidth / fNoiseWidth);
-      // low frequency cutoff
-      lofilter = 1.0 / (1.0 + exp(-(i - fLowCutoff / binWidth) / 0.5));
-      // randomize 10%
-
-      pval *= lofilter * ((1 - fNoiseRand) + 2 * fNoiseRand * rnd[0]);
-    }
-
-
-    else
-    {
-
-      pval = fNoiseHist->GetBinContent(i) * ((1 - fNoiseRand) + 2 * fNoiseRand * rnd[0]) * noise_factor;
-    }
-    */
     phase = rnd[1] * 2.*TMath::Pi();
     TComplex tc(pval * cos(phase), pval * sin(phase));
     noiseFrequency.at(i) += tc;
   }
+}
 
+//**********************************************************************
 
-  // inverse FFT MCSignal
-  fFFT->DoInvFFT(noiseFrequency, sigs);
+void SBNDThermalNoiseServiceInFreq::buildNoiseBank() {
+  const string myname = "SBNDThermalNoiseServiceInFreq::buildNoiseBank: ";
 
-  noiseFrequency.clear();
+  art::ServiceHandle<util::LArFFT> fFFT;
+  size_t fNTicks = fFFT->FFTSize();
+  util::FFTWorkspaceSBND fft(fNTicks, fFFT->FFTOptions());
+
+  if ( !fNoiseBankFile.empty() ) {
+    fNoiseBank.Load(fNoiseBankFile, "ThermalNoiseBank", 1);
+    if ( fNoiseBank.empty() || fNoiseBank.NTicks() != fNTicks )
+      throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+        << "Noise bank in " << fNoiseBankFile << " has " << fNoiseBank.NTicks()
+        << " ticks, expected " << fNTicks << "\n";
+    if ( fLogLevel > 0 ) cout << myname << "Read " << fNoiseBank.NEntries()
+                              << " noise waveforms from " << fNoiseBankFile << endl;
+    return;
+  }
 
-  // multiply each noise value by fNTicks as the InvFFT
-   // divides each bin by fNTicks assuming that a forward FFT
-  // has already been done.
-  for (unsigned int i = 0; i < sigs.size(); ++i) {
-    sigs.at(i) *= 1.*fNTicks;
+  if ( !fNoiseEngine )
+    throw cet::exception("SBNDThermalNoiseServiceInFreq_service.cc")
+      << "Noise engine not initialised before the noise bank is generated\n";
+
+  CLHEP::RandFlat flat(*fNoiseEngine, -1, 1);
+  fNoiseBank = sbnd::NoiseBankSBND(1, fNoiseArrayPoints, fNTicks);
+
+  std::vector<TComplex> noiseFrequency;
+  std::vector<double> noise(fNTicks, 0.);
+  for (unsigned int e = 0; e < fNoiseArrayPoints; ++e) {
+    noiseFrequency.assign(fNTicks / 2 + 1, 0.);
+    fillNoiseSpectrum(flat, fNTicks, noiseFrequency);
+    fft.DoInvFFT(noiseFrequency, noise);
+    float* wf = fNoiseBank.Waveform(0, e);
+    for (size_t i = 0; i < fNTicks; ++i) wf[i] = noise[i]*fNTicks;
   }
-  
-  return 0;
+
+  if ( fSaveNoiseBank ) fNoiseBank.Save("ThermalNoiseBank");
+  if ( fLogLevel > 0 ) cout << myname << "Generated " << fNoiseArrayPoints << " noise waveforms" << endl;
 }
 
 
@@ -189,6 +295,9 @@ ostream& SBNDThermalNoiseServiceInFreq::print(ostream& out, string prefix) const
   out << prefix << "          LogLevel: " <<  fLogLevel << endl;
   out << prefix << "        RandomSeed: " <<  fRandomSeed << endl;
   out << prefix << "  NoiseArrayPoints: " << fNoiseArrayPoints << endl;
+  out << prefix << "      UseNoiseBank: " << fUseNoiseBank << endl;
+  out << prefix << "      BatchedNoise: " << fBatchedNoise << endl;
+  if ( fUseNoiseBank ) out << prefix << "     NoiseBankFile: " << fNoiseBankFile << endl;
   
   return out;
 }
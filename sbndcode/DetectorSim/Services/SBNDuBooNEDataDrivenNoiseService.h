@@ -21,6 +21,8 @@
 #define SBNDuBooNEDataDrivenNoiseService_H
 
 #include "sbndcode/DetectorSim/Services/ChannelNoiseService.h"
+#include "sbndcode/DetectorSim/Services/NoiseBankSBND.h"
+#include "sbndcode/DetectorSim/Services/BatchedNoiseSBND.h"
 
 #include "art_root_io/TFileService.h"
 #include "art/Framework/Services/Registry/ServiceDeclarationMacros.h"
@@ -38,6 +40,8 @@
 #include "TF1.h"
 #include "TMath.h"
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <iostream>
 #include <sstream>
@@ -88,12 +92,33 @@ private:
 	                    float cohExpNorm, float cohExpWidth, float cohExpOffset, 
 	                    TH1* aNoiseHist) const;
   
-  // Make coherent groups
-  void makeCoherentGroupsByOfflineChannel(unsigned int nchpergroup);
+  // Spectrum functions of the Gaussian and coherent noise; caller owns them.
+  TF1* makeGaussianNoiseFunction(std::vector<float> const& gausNorm,
+                                 std::vector<float> const& gausMean,
+                                 std::vector<float> const& gausSigma) const;
+  TF1* makeCoherentNoiseFunction(std::vector<float> const& gausNorm,
+                                 std::vector<float> const& gausMean,
+                                 std::vector<float> const& gausSigma,
+                                 float cohExpNorm, float cohExpWidth, float cohExpOffset) const;
+
+  // Fill nArrays noise arrays from the spectrum func with BatchedNoiseSBND,
+  // array i being stream firstStream + i.
+  void generateBatchedNoise(detinfo::DetectorClocksData const& clockData,
+                            AdcSignalVectorVector& noise, unsigned int nArrays,
+                            TF1* func, uint64_t firstStream, TH1* aNoiseHist);
+
+  // Wire length dependence of the MicroBooNE noise model for a channel.
+  double wireLengthFactor(Channel chan) const;
+
+  // Fill fMicroBooNoiseBank, either from fNoiseBankFile or by generating it.
+  void buildNoiseBank();
+
+  // Make coherent groups: runs of consecutive offline channels of one plane,
+  // fNChannelsPerCoherentGroup[plane] channels long.
+  void makeCoherentGroupsByOfflineChannel();
   std::vector<unsigned int> fChannelGroupMap;   ///< assign each channel a group number
-  std::vector<int> fGroupCoherentNoiseMap; ///< assign each group a noise 
+  unsigned int fNCoherentGroups;                ///< number of groups in fChannelGroupMap
   unsigned int getGroupNumberFromOfflineChannel(unsigned int offlinechan) const;
-  unsigned int getCohNoiseChanFromGroup(unsigned int cohgroup) const;
   
   // General parameters
   unsigned int fNoiseArrayPoints;  ///< number of points in randomly generated noise array
@@ -128,12 +153,26 @@ private:
   float        fVFirstJumper;         ///< Wire number of first wire on V layer to include a jumper cable. Defaults to 0 if not included.
   float        fVLastJumper;          ///< Wire number of last wire on V layer to include a jumper cable. Defaults to 0 if not included.
   std::vector<float>  fNoiseFunctionParameters;  ///< Parameters in the MicroBooNE noise model
+
+  // MicroBooNE noise bank. The model is linear in the wire length term, so
+  // each entry holds the waveform of the constant part (component 0) and of
+  // the part scaled by the wire length factor (component 1), made with the
+  // same random amplitudes and phases.
+  bool                fUseNoiseBank;       ///< take MicroBooNE noise from the bank instead of an FFT per channel
+  std::string         fNoiseBankFile;      ///< file to read the bank from; generated if empty
+  bool                fSaveNoiseBank;      ///< write a generated bank to the histogram file
+  sbnd::NoiseBankSBND fMicroBooNoiseBank;
+
+  // Batched synthesis of the Gaussian and coherent noise arrays
+  bool                fBatchedNoise;       ///< synthesise the arrays with BatchedNoiseSBND
+  uint64_t            fBatchSeed;          ///< seed of the current event
+  std::unique_ptr<sbnd::BatchedNoiseSBND> fBatchedSynth;
+  std::vector<float>  fWireLengthFactor;   ///< wire length factor of each channel
   
   // Coherent Noise parameters
   bool         fEnableCoherentNoise;
   std::vector<unsigned int> fNChannelsPerCoherentGroup;
   unsigned int fExpNoiseArrayPoints;  ///< number of points in randomly generated noise array
-  unsigned int fCohNoiseArrayPoints;  ///< number of points in randomly generated noise array
   float        fCohExpNorm;           ///< noise scale factor for the exponential component component in coherent noise
   float        fCohExpWidth;          ///< width of the exponential component in coherent noise
   float        fCohExpOffset;         ///< Amplitude offset of the exponential background component in coherent noise
@@ -153,9 +192,7 @@ private:
   AdcSignalVectorVector fMicroBooNoiseV;
   
   // Coherent Noise array.
-  AdcSignalVectorVector fCohNoiseZ;  ///< noise on each channel for each time for all planes  
-  AdcSignalVectorVector fCohNoiseU;  ///< noise on each channel for each time for all planes
-  AdcSignalVectorVector fCohNoiseV;  ///< noise on each channel for each time for all planes
+  AdcSignalVectorVector fCohGroupNoise;  ///< noise of each coherent group for the current event
 
 
   // Histograms.
@@ -171,7 +208,7 @@ private:
   TH1* fMicroBooNoiseChanHist;  ///< distribution of accessed noise samples
   
   TH1* fCohNoiseHist;      ///< distribution of noise counts
-  TH1* fCohNoiseChanHist;  ///< distribution of accessed noise samples
+  TH1* fCohNoiseChanHist;  ///< distribution of accessed coherent groups
 
   TF1* _wld_f;
   double wldparams[2];
@@ -6,6 +6,9 @@
 #include "sbndcode/DetectorSim/Services/SBNDuBooNEDataDrivenNoiseService.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "art/Framework/Services/Registry/ServiceDefinitionMacros.h"
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
 
 using std::cout;
 using std::ostream;
@@ -61,9 +64,13 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fVFirstJumper        = pset.get<double>("VFirstJumper");
   fVLastJumper         = pset.get<double>("VLastJumper");
   fNoiseFunctionParameters   = pset.get<std::vector<float>>("NoiseFunctionParameters");
+  fUseNoiseBank        = pset.get<bool>("UseNoiseBank", false);
+  fNoiseBankFile       = pset.get<std::string>("NoiseBankFile", "");
+  fSaveNoiseBank       = pset.get<bool>("SaveNoiseBank", false);
+  fBatchedNoise        = pset.get<bool>("BatchedNoise", false);
+  fBatchSeed           = 0;
   
   fEnableCoherentNoise = pset.get<bool>("EnableCoherentNoise");
-  fCohNoiseArrayPoints = pset.get<unsigned int>("CohNoiseArrayPoints");
   fCohExpNorm          = pset.get<float>("CohExpNorm");
   fCohExpWidth         = pset.get<float>("CohExpWidth");
   fCohExpOffset        = pset.get<float>("CohExpOffset");
@@ -82,7 +89,10 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
   fGausNoiseHistV = tfs->make<TH1F>("Gaussian vnoise", ";V Noise [ADC counts];", 1000,   -10., 10.);
   fGausNoiseChanHist = tfs->make<TH1F>("Gaussian NoiseChan", ";Gaussian Noise channel;", fNoiseArrayPoints, 0, fNoiseArrayPoints);
   fCohNoiseHist = tfs->make<TH1F>("Cohnoise", ";Coherent Noise [ADC counts];", 1000,   -10., 10.);                           
-  fCohNoiseChanHist = tfs->make<TH1F>("CohNoiseChan", ";CohNoise channel;", fCohNoiseArrayPoints, 0, fCohNoiseArrayPoints);// III = for each instance of this class.
+  
+  fNCoherentGroups = 0;
+  if ( fEnableCoherentNoise ) makeCoherentGroupsByOfflineChannel();
+  fCohNoiseChanHist = tfs->make<TH1F>("CohNoiseChan", ";CohNoise group;", fNCoherentGroups, 0, fNCoherentGroups);// III = for each instance of this class.
   
   //generateNoise(); //This has been replaced by the same function in SimWireSBND. This is so the noise arrays are recalculated for each event.
 
@@ -102,8 +112,11 @@ SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset)
 //**********************************************************************
 
 SBNDuBooNEDataDrivenNoiseService::
-SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset, art::ActivityRegistry&)
-: SBNDuBooNEDataDrivenNoiseService(pset) { }
+SBNDuBooNEDataDrivenNoiseService(fhicl::ParameterSet const& pset, art::ActivityRegistry& reg)
+: SBNDuBooNEDataDrivenNoiseService(pset) {
+  if ( fUseNoiseBank && fEnableMicroBooNoise )
+    reg.sPostBeginJob.watch(this, &SBNDuBooNEDataDrivenNoiseService::buildNoiseBank);
+}
 
 //**********************************************************************
 
@@ -158,15 +171,125 @@ int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const
   if ( gausNoiseChan == fNoiseArrayPoints ) --gausNoiseChan;
   fGausNoiseChanHist->Fill(gausNoiseChan);
   
-  unsigned int cohNoisechan = -999;
   unsigned int groupNum = -999;
   if ( fEnableCoherentNoise ) {
     groupNum = getGroupNumberFromOfflineChannel(chan);
-    cohNoisechan = getCohNoiseChanFromGroup(groupNum);
-    if ( cohNoisechan == fCohNoiseArrayPoints ) cohNoisechan = fCohNoiseArrayPoints-1;
-    fCohNoiseChanHist->Fill(cohNoisechan);
+    fCohNoiseChanHist->Fill(groupNum);
   }
 
+  art::ServiceHandle<geo::Geometry> geo;
+
+  ////////////////////////////// MicroBooNE noise model/////////////////////////////////
+  std::vector<double> noisevector(sigs.size(), 0.0);
+  if ( fUseNoiseBank ) {
+    // random entry of the bank, read from a random tick
+    if ( fEnableMicroBooNoise ) {
+      const sbnd::NoiseBankSBND::Draw draw = fMicroBooNoiseBank.Pick(*m_pran);
+      fMicroBooNoiseBank.Add(0, draw, 1., noisevector);
+      fMicroBooNoiseBank.Add(1, draw, fWireLengthFactor.at(chan), noisevector);
+    }
+  }
+  else {
+
+    ///This part below has been moved from the generateMicroBooNoise section as it needs to be done differently for SBND due to different wirelengths.
+
+    // vars
+
+    // Fetch sampling rate.
+    float sampleRate = sampling_rate(clockData);
+    // Fetch FFT service and # ticks.
+    art::ServiceHandle<util::LArFFT> pfft;
+    unsigned int ntick = pfft->FFTSize(); //waveform_size
+    util::FFTWorkspaceSBND fft(ntick, pfft->FFTOptions());
+    // width of frequencyBin in kHz
+    double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
+
+    // Create noise spectrum in frequency.
+    unsigned nbin = ntick/2 + 1;
+    std::vector<TComplex> noiseFrequency(nbin, 0.);
+    double pval = 0.;
+    double phase = 0.;
+    double rnd[3] = {0.};
+
+    noisevector.assign(ntick, 0.0);
+    double fitpar[9] = {0.};
+
+    // gain function in kHz
+    TF1* _pfn_f1 = new TF1("_pfn_f1", "([0]*1/(x/1000*[8]/2) + ([1]*exp(-0.5*(((x/1000*[8]/2)-[2])/[3])**2)*exp(-0.5*pow(x/1000*[8]/(2*[4]),[5])))*[6]) + [7]", 0.0, 0.5*ntick*binWidth);
+    // set data-driven parameters
+
+    double wldValue = wireLengthFactor(chan);
+
+    fitpar[0] = fNoiseFunctionParameters.at(0);
+    fitpar[1] = fNoiseFunctionParameters.at(1);
+    fitpar[2] = fNoiseFunctionParameters.at(2);
+    fitpar[3] = fNoiseFunctionParameters.at(3);
+    fitpar[4] = fNoiseFunctionParameters.at(4);
+    fitpar[5] = fNoiseFunctionParameters.at(5);
+    fitpar[6] = wldValue; //wire length parameter
+    fitpar[7] = fNoiseFunctionParameters.at(7); //baseline_noise
+    fitpar[8] = 9596; //uBooNE nticks. Using SBND (or ProtoDUNE) nticks changes the model significantly, so we stick with the uBooNE nticks. 
+
+    _pfn_f1->SetParameters(fitpar);
+    _pfn_f1->SetNpx(1000);
+
+    for ( unsigned int i=0; i<ntick/2+1; ++i ) {
+      //MicroBooNE noise model
+      double pfnf1val = _pfn_f1->Eval((i+0.5)*binWidth);
+      // define FFT parameters
+      double randPoisson = GetRandomTF1(_poisson);
+      double randomizer = randPoisson/kPoissonMean;
+      pval = pfnf1val * randomizer;
+      // random phase angle
+      flat.fireArray(2, rnd, 0, 1);
+      phase = rnd[1]*2.*TMath::Pi();
+      TComplex tc(pval*cos(phase),pval*sin(phase));
+      noiseFrequency[i] += tc;
+    }
+
+
+    // Obtain time spectrum from frequency spectrum.
+    std::vector<double> tmpnoise(noisevector.size());
+    fft.DoInvFFT(noiseFrequency, tmpnoise);
+    noiseFrequency.clear();
+    for ( unsigned int itck=0; itck<noisevector.size(); ++itck ) {
+      noisevector[itck] = sqrt(ntick)*tmpnoise[itck];
+    }
+    // end of moved section.
+
+    _pfn_f1->Delete();
+
+  }
+
+  const geo::View_t view = geo->View(chan);
+  for ( unsigned int itck=0; itck<sigs.size(); ++itck ) {
+    double tnoise = 0;
+    if ( view==geo::kU ) {
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseU*gaus.fire();
+      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
+      if(fEnableGaussianNoise) tnoise += fGausNoiseU[gausNoiseChan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohGroupNoise[groupNum][itck];
+    } 
+    else if ( view==geo::kV ) {
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseV*gaus.fire();
+      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
+      if(fEnableGaussianNoise) tnoise += fGausNoiseV[gausNoiseChan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohGroupNoise[groupNum][itck];
+    } 
+    else {
+      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseZ*gaus.fire();
+      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
+      if(fEnableGaussianNoise) tnoise += fGausNoiseZ[gausNoiseChan][itck];
+      if(fEnableCoherentNoise) tnoise += fCohGroupNoise[groupNum][itck];
+    }      
+    sigs[itck] += tnoise;
+  }
+  return 0;
+}
+
+//**********************************************************************
+
+double SBNDuBooNEDataDrivenNoiseService::wireLengthFactor(Channel chan) const {
   art::ServiceHandle<geo::Geometry> geo;
   std::vector<geo::WireID> wireIDs = geo->ChannelToWire(chan);
   unsigned int wireID = wireIDs.front().Wire;
@@ -184,101 +307,83 @@ int SBNDuBooNEDataDrivenNoiseService::addNoise(detinfo::DetectorClocksData const
   //include for 0 wirelength tests.
   //wirelength = 0;
 
+  return _wld_f->Eval(wirelength);
+}
+
+//**********************************************************************
 
-  ///This part below has been moved from the generateMicroBooNoise section as it needs to be done differently for SBND due to different wirelengths.
+void SBNDuBooNEDataDrivenNoiseService::buildNoiseBank() {
+  const string myname = "SBNDuBooNEDataDrivenNoiseService::buildNoiseBank: ";
 
-  ////////////////////////////// MicroBooNE noise model/////////////////////////////////
-  // vars
+  // the wire length factor of every channel, to scale component 1
+  art::ServiceHandle<geo::Geometry> geo;
+  fWireLengthFactor.resize(geo->Nchannels());
+  for ( unsigned int chan=0; chan<geo->Nchannels(); ++chan ) fWireLengthFactor[chan] = wireLengthFactor(chan);
 
-  // Fetch sampling rate.
-  float sampleRate = sampling_rate(clockData);
-  // Fetch FFT service and # ticks.
   art::ServiceHandle<util::LArFFT> pfft;
-  unsigned int ntick = pfft->FFTSize(); //waveform_size
-  // width of frequencyBin in kHz
-  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
+  unsigned int ntick = pfft->FFTSize();
+  util::FFTWorkspaceSBND fft(ntick, pfft->FFTOptions());
+
+  if ( !fNoiseBankFile.empty() ) {
+    fMicroBooNoiseBank.Load(fNoiseBankFile, "MicroBooNoiseBank", 2);
+    if ( fMicroBooNoiseBank.empty() || fMicroBooNoiseBank.NTicks() != ntick )
+      throw cet::exception("SBNDuBooNEDataDrivenNoiseService")
+        << "Noise bank in " << fNoiseBankFile << " has " << fMicroBooNoiseBank.NTicks()
+        << " ticks, expected " << ntick << "\n";
+    if ( fLogLevel > 0 ) cout << myname << "Read " << fMicroBooNoiseBank.NEntries()
+                              << " noise waveforms from " << fNoiseBankFile << endl;
+    return;
+  }
 
-  // Create noise spectrum in frequency.
+  auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
+  float sampleRate = sampling_rate(clockData);
+  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
   unsigned nbin = ntick/2 + 1;
-  std::vector<TComplex> noiseFrequency(nbin, 0.);
-  double pval = 0.;
-  double phase = 0.;
-  double rnd[3] = {0.};
 
-  std::vector<double> noisevector(ntick,0.0);
-  double fitpar[9] = {0.};
-  
-  // gain function in kHz
+  // the two parts of the spectrum, without and with the wire length term
   TF1* _pfn_f1 = new TF1("_pfn_f1", "([0]*1/(x/1000*[8]/2) + ([1]*exp(-0.5*(((x/1000*[8]/2)-[2])/[3])**2)*exp(-0.5*pow(x/1000*[8]/(2*[4]),[5])))*[6]) + [7]", 0.0, 0.5*ntick*binWidth);
-  // set data-driven parameters
- 
-  double wldValue = _wld_f->Eval(wirelength);
-
-  fitpar[0] = fNoiseFunctionParameters.at(0);
-  fitpar[1] = fNoiseFunctionParameters.at(1);
-  fitpar[2] = fNoiseFunctionParameters.at(2);
-  fitpar[3] = fNoiseFunctionParameters.at(3);
-  fitpar[4] = fNoiseFunctionParameters.at(4);
-  fitpar[5] = fNoiseFunctionParameters.at(5);
-  fitpar[6] = wldValue; //wire length parameter
+  double fitpar[9] = {0.};
+  for ( unsigned int i=0; i<6; ++i ) fitpar[i] = fNoiseFunctionParameters.at(i);
   fitpar[7] = fNoiseFunctionParameters.at(7); //baseline_noise
-  fitpar[8] = 9596; //uBooNE nticks. Using SBND (or ProtoDUNE) nticks changes the model significantly, so we stick with the uBooNE nticks. 
-
+  fitpar[8] = 9596; //uBooNE nticks, as in addNoise
   _pfn_f1->SetParameters(fitpar);
   _pfn_f1->SetNpx(1000);
 
-  for ( unsigned int i=0; i<ntick/2+1; ++i ) {
-    //MicroBooNE noise model
-    double pfnf1val = _pfn_f1->Eval((i+0.5)*binWidth);
-    // define FFT parameters
-    double randPoisson = GetRandomTF1(_poisson);
-    double randomizer = randPoisson/kPoissonMean;
-    pval = pfnf1val * randomizer;
-    // random phase angle
-    flat.fireArray(2, rnd, 0, 1);
-    phase = rnd[1]*2.*TMath::Pi();
-    TComplex tc(pval*cos(phase),pval*sin(phase));
-    noiseFrequency[i] += tc;
+  std::vector<double> constPart(nbin), lengthPart(nbin);
+  for ( unsigned int i=0; i<nbin; ++i ) {
+    _pfn_f1->SetParameter(6, 0.);
+    constPart[i] = _pfn_f1->Eval((i+0.5)*binWidth);
+    _pfn_f1->SetParameter(6, 1.);
+    lengthPart[i] = _pfn_f1->Eval((i+0.5)*binWidth) - constPart[i];
   }
+  _pfn_f1->Delete();
 
+  CLHEP::RandFlat flat(*m_pran);
+  fMicroBooNoiseBank = sbnd::NoiseBankSBND(2, fNoiseArrayPoints, ntick);
 
-  // Obtain time spectrum from frequency spectrum.
-  std::vector<double> tmpnoise(noisevector.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
-  noiseFrequency.clear();
-  for ( unsigned int itck=0; itck<noisevector.size(); ++itck ) {
-    noisevector[itck] = sqrt(ntick)*tmpnoise[itck];
-  }
-  // end of moved section.
-
-  _pfn_f1->Delete();
-  
+  std::vector<TComplex> constFrequency(nbin), lengthFrequency(nbin);
+  std::vector<double> tmpnoise(ntick);
+  double rnd[2] = {0.};
+  for ( unsigned int e=0; e<fNoiseArrayPoints; ++e ) {
+    for ( unsigned int i=0; i<nbin; ++i ) {
+      double randomizer = GetRandomTF1(_poisson)/kPoissonMean;
+      flat.fireArray(2, rnd, 0, 1);
+      double phase = rnd[1]*2.*TMath::Pi();
+      constFrequency[i] = TComplex(constPart[i]*randomizer*cos(phase), constPart[i]*randomizer*sin(phase));
+      lengthFrequency[i] = TComplex(lengthPart[i]*randomizer*cos(phase), lengthPart[i]*randomizer*sin(phase));
+    }
 
+    fft.DoInvFFT(constFrequency, tmpnoise);
+    float* wf = fMicroBooNoiseBank.Waveform(0, e);
+    for ( unsigned int itck=0; itck<ntick; ++itck ) wf[itck] = sqrt(ntick)*tmpnoise[itck];
 
-  const geo::View_t view = geo->View(chan);
-  for ( unsigned int itck=0; itck<sigs.size(); ++itck ) {
-    double tnoise = 0;
-    if ( view==geo::kU ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseU*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseU[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseU[cohNoisechan][itck];
-    } 
-    else if ( view==geo::kV ) {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseV*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseV[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseV[cohNoisechan][itck];
-    } 
-    else {
-      if(fEnableWhiteNoise)    tnoise += fWhiteNoiseZ*gaus.fire();
-      if(fEnableMicroBooNoise) tnoise += noisevector[itck];
-      if(fEnableGaussianNoise) tnoise += fGausNoiseZ[gausNoiseChan][itck];
-      if(fEnableCoherentNoise) tnoise += fCohNoiseZ[cohNoisechan][itck];
-    }      
-    sigs[itck] += tnoise;
+    fft.DoInvFFT(lengthFrequency, tmpnoise);
+    wf = fMicroBooNoiseBank.Waveform(1, e);
+    for ( unsigned int itck=0; itck<ntick; ++itck ) wf[itck] = sqrt(ntick)*tmpnoise[itck];
   }
-  return 0;
+
+  if ( fSaveNoiseBank ) fMicroBooNoiseBank.Save("MicroBooNoiseBank");
+  if ( fLogLevel > 0 ) cout << myname << "Generated " << fNoiseArrayPoints << " MicroBooNE noise waveforms" << endl;
 }
 
 //**********************************************************************
@@ -332,13 +437,17 @@ ostream& SBNDuBooNEDataDrivenNoiseService::print(ostream& out, string prefix) co
   out << prefix << "       VFirstJumper: " << fVFirstJumper  << endl;
   out << prefix << "        VLastJumper: " << fVLastJumper  << endl;
   
+  out << prefix << "       UseNoiseBank: " << fUseNoiseBank  << endl;
+  out << prefix << "      NoiseBankFile: " << fNoiseBankFile  << endl;
+  out << prefix << "       BatchedNoise: " << fBatchedNoise  << endl;
+
   out << prefix << "MicroBoo model parameters: [ ";  
   for(int i=0; i<(int)fNoiseFunctionParameters.size(); i++) { out <<  fNoiseFunctionParameters.at(i) << " ";}
   out << " ]" << endl;
     
   out << prefix << "EnableCoherentNoise: " << fEnableCoherentNoise   << endl;
   out << prefix << "ExpNoiseArrayPoints: " << fExpNoiseArrayPoints << endl;
-  out << prefix << "CohNoiseArrayPoints: " << fCohNoiseArrayPoints << endl;
+  out << prefix << "   CoherentGroups: " << fNCoherentGroups << endl;
   
   out << prefix << "     CohGausNorm: [ ";  
   for(int i=0; i<(int)fCohGausNorm.size(); i++) { out <<  fCohGausNorm.at(i) << " ";}
@@ -365,32 +474,14 @@ generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
   if ( fLogLevel > 1 ) {
     cout << myname << "Generating Gaussian noise." << endl;  
   }
-  //--- get number of gaussians ---  
-  int a = gausNorm.size();
-  int b = gausMean.size();
-  int c = gausSigma.size();
-  int NGausians = a<b?a:b;
-  NGausians = NGausians<c?NGausians:c;
-  //--- set function formula ---
-  std::stringstream  name;
-  name.str("");
-  for(int i=0;i<NGausians;i++) {
-  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
-  }
-  name<<"0";
-  TF1 *funcGausNoise = new TF1("funcGausInhNoise",name.str().c_str(), 0, 1200);
-  funcGausNoise->SetNpx(12000);
-  for(int i=0;i<NGausians;i++) {
-    funcGausNoise->SetParameter(3*i, gausNorm.at(i));	
-    funcGausNoise->SetParameter(3*i+1, gausMean.at(i));	
-    funcGausNoise->SetParameter(3*i+2, gausSigma.at(i));	
-  }
+  TF1 *funcGausNoise = makeGaussianNoiseFunction(gausNorm, gausMean, gausSigma);
   
   // Fetch sampling rate.
   float sampleRate = sampling_rate(clockData);
   // Fetch FFT service and # ticks.
   art::ServiceHandle<util::LArFFT> pfft;
   unsigned int ntick = pfft->FFTSize();
+  util::FFTWorkspaceSBND fft(ntick, pfft->FFTOptions());
   CLHEP::RandFlat flat(*m_pran);
   // Create noise spectrum in frequency.
   unsigned nbin = ntick/2 + 1;
@@ -415,7 +506,7 @@ generateGaussianNoise(detinfo::DetectorClocksData const& clockData,
   noise.clear();
   noise.resize(ntick,0.0);
   std::vector<double> tmpnoise(noise.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
+  fft.DoInvFFT(noiseFrequency, tmpnoise);
   noiseFrequency.clear();
   
   for ( unsigned int itck=0; itck<noise.size(); ++itck ) {
@@ -439,29 +530,8 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
   if ( fLogLevel > 1 ) {
     cout << myname << "Generating Coherent Gaussian noise." << endl;  
   }
-  //--- get number of gaussians ---  
-  int a = gausNorm.size();
-  int b = gausMean.size();
-  int c = gausSigma.size();
-  int NGausians = a<b?a:b;
-  NGausians = NGausians<c?NGausians:c;
-  //--- set function formula ---
-  std::stringstream  name;
-  name.str("");
-  for(int i=0;i<NGausians;i++) {
-  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
-  }
-  name<<"["<<3*NGausians<<"]*exp(-x/["<<3*NGausians+1<<"]) + ["<<3*NGausians+2<<"]";
-  TF1 *funcCohNoise = new TF1("funcGausCohsNoise",name.str().c_str(), 0, 1200);
-  funcCohNoise->SetNpx(12000);
-  for(int i=0;i<NGausians;i++) {
-    funcCohNoise->SetParameter(3*i, gausNorm.at(i));	
-    funcCohNoise->SetParameter(3*i+1, gausMean.at(i));	
-    funcCohNoise->SetParameter(3*i+2, gausSigma.at(i));	
-  }
-  funcCohNoise->SetParameter(3*NGausians, cohExpNorm);
-  funcCohNoise->SetParameter(3*NGausians+1, cohExpWidth);
-  funcCohNoise->SetParameter(3*NGausians+2, cohExpOffset);
+  TF1 *funcCohNoise = makeCoherentNoiseFunction(gausNorm, gausMean, gausSigma,
+                                                cohExpNorm, cohExpWidth, cohExpOffset);
   
   // custom poisson  
   TF1* _poisson = new TF1("_poisson", "[0]**(x) * exp(-[0]) / ROOT::Math::tgamma(x+1.)", 0, 30);
@@ -474,6 +544,7 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
   // Fetch FFT service and # ticks.
   art::ServiceHandle<util::LArFFT> pfft;
   unsigned int ntick = pfft->FFTSize();
+  util::FFTWorkspaceSBND fft(ntick, pfft->FFTOptions());
   CLHEP::RandFlat flat(*m_pran);
   // Create noise spectrum in frequency.
   unsigned nbin = ntick/2 + 1;
@@ -497,7 +568,7 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
   noise.clear();
   noise.resize(ntick,0.0);
   std::vector<double> tmpnoise(noise.size());
-  pfft->DoInvFFT(noiseFrequency, tmpnoise);
+  fft.DoInvFFT(noiseFrequency, tmpnoise);
   noiseFrequency.clear();
   
   // Note: Assume that the frequency function is obtained from a fit 
@@ -522,24 +593,118 @@ void SBNDuBooNEDataDrivenNoiseService::generateCoherentNoise(detinfo::DetectorCl
 
 //**********************************************************************
 
-void SBNDuBooNEDataDrivenNoiseService::makeCoherentGroupsByOfflineChannel(unsigned int nchpergroup) {
-	CLHEP::RandFlat flat(*m_pran);
-	CLHEP::RandGauss gaus(*m_pran);
+TF1* SBNDuBooNEDataDrivenNoiseService::makeGaussianNoiseFunction(std::vector<float> const& gausNorm,
+                                                                 std::vector<float> const& gausMean,
+                                                                 std::vector<float> const& gausSigma) const {
+  //--- get number of gaussians ---  
+  int a = gausNorm.size();
+  int b = gausMean.size();
+  int c = gausSigma.size();
+  int NGausians = a<b?a:b;
+  NGausians = NGausians<c?NGausians:c;
+  //--- set function formula ---
+  std::stringstream  name;
+  name.str("");
+  for(int i=0;i<NGausians;i++) {
+  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
+  }
+  name<<"0";
+  TF1 *funcGausNoise = new TF1("funcGausInhNoise",name.str().c_str(), 0, 1200);
+  funcGausNoise->SetNpx(12000);
+  for(int i=0;i<NGausians;i++) {
+    funcGausNoise->SetParameter(3*i, gausNorm.at(i));	
+    funcGausNoise->SetParameter(3*i+1, gausMean.at(i));	
+    funcGausNoise->SetParameter(3*i+2, gausSigma.at(i));	
+  }
+  return funcGausNoise;
+}
+
+//**********************************************************************
+
+TF1* SBNDuBooNEDataDrivenNoiseService::makeCoherentNoiseFunction(std::vector<float> const& gausNorm,
+                                                                 std::vector<float> const& gausMean,
+                                                                 std::vector<float> const& gausSigma,
+                                                                 float cohExpNorm, float cohExpWidth,
+                                                                 float cohExpOffset) const {
+  //--- get number of gaussians ---  
+  int a = gausNorm.size();
+  int b = gausMean.size();
+  int c = gausSigma.size();
+  int NGausians = a<b?a:b;
+  NGausians = NGausians<c?NGausians:c;
+  //--- set function formula ---
+  std::stringstream  name;
+  name.str("");
+  for(int i=0;i<NGausians;i++) {
+  	name<<"["<<3*i<<"]*exp(-0.5*pow((x-["<<3*i+1<<"])/["<<3*i+2<<"],2))+";
+  }
+  name<<"["<<3*NGausians<<"]*exp(-x/["<<3*NGausians+1<<"]) + ["<<3*NGausians+2<<"]";
+  TF1 *funcCohNoise = new TF1("funcGausCohsNoise",name.str().c_str(), 0, 1200);
+  funcCohNoise->SetNpx(12000);
+  for(int i=0;i<NGausians;i++) {
+    funcCohNoise->SetParameter(3*i, gausNorm.at(i));	
+    funcCohNoise->SetParameter(3*i+1, gausMean.at(i));	
+    funcCohNoise->SetParameter(3*i+2, gausSigma.at(i));	
+  }
+  funcCohNoise->SetParameter(3*NGausians, cohExpNorm);
+  funcCohNoise->SetParameter(3*NGausians+1, cohExpWidth);
+  funcCohNoise->SetParameter(3*NGausians+2, cohExpOffset);
+  return funcCohNoise;
+}
+
+//**********************************************************************
+
+void SBNDuBooNEDataDrivenNoiseService::generateBatchedNoise(detinfo::DetectorClocksData const& clockData,
+                                                            AdcSignalVectorVector& noise, unsigned int nArrays,
+                                                            TF1* func, uint64_t firstStream, TH1* aNoiseHist) {
+  // Fetch sampling rate.
+  float sampleRate = sampling_rate(clockData);
+  // Fetch FFT service and # ticks.
+  art::ServiceHandle<util::LArFFT> pfft;
+  unsigned int ntick = pfft->FFTSize();
+  if ( !fBatchedSynth || fBatchedSynth->NTicks() != ntick )
+    fBatchedSynth = std::make_unique<sbnd::BatchedNoiseSBND>(ntick, pfft->FFTOptions());
+
+  // width of frequencyBin in kHz
+  double binWidth = 1.0/(ntick*sampleRate*1.0e-6);
+  std::vector<float> shape(ntick/2 + 1);
+  for ( unsigned int i=0; i<shape.size(); ++i ) shape[i] = func->Eval((double)i*binWidth);
+
+  // amplitudes randomised within 10%; see generateCoherentNoise() for the sqrt(ntick)
+  noise.resize(nArrays);
+  std::vector<uint64_t> streams(nArrays);
+  std::vector<double> scales(nArrays, sqrt(ntick));
+  std::vector<AdcSignalVector*> outputs(nArrays);
+  for ( unsigned int i=0; i<nArrays; ++i ) {
+    noise[i].assign(ntick, 0.0);
+    streams[i] = firstStream + i;
+    outputs[i] = &noise[i];
+  }
+  fBatchedSynth->Synthesize(shape, 0.1, fBatchSeed, streams, scales, outputs);
+
+  for ( auto const& wf: noise ) {
+    for ( float v: wf ) aNoiseHist->Fill(v);
+  }
+}
+
+//**********************************************************************
+
+void SBNDuBooNEDataDrivenNoiseService::makeCoherentGroupsByOfflineChannel() {
 	art::ServiceHandle<geo::Geometry> geo;
 	const unsigned int nchan = geo->Nchannels();
 	fChannelGroupMap.resize(nchan);
-	unsigned int numberofgroups = 0;
-	if(nchan%nchpergroup == 0) numberofgroups = nchan/nchpergroup;
-	else numberofgroups = nchan/nchpergroup +1;
-	unsigned int cohGroupNo = 0;
+	fNCoherentGroups = 0;
+	unsigned int nInGroup = 0;
+	unsigned int prevPlane = -999;
 	for(unsigned int chan=0; chan<nchan; chan++) {
-	  cohGroupNo = chan/nchpergroup; //group number
-	  fChannelGroupMap[chan] = cohGroupNo; 
-	}
-	fGroupCoherentNoiseMap.resize(numberofgroups);
-	for(unsigned int ng=0; ng<numberofgroups; ng++) {
-	  unsigned int cohNoiseChan = flat.fire()*fCohNoiseArrayPoints;
-	  fGroupCoherentNoiseMap[ng] = cohNoiseChan;
+	  const unsigned int plane = std::min<unsigned int>(geo->View(chan), fNChannelsPerCoherentGroup.size()-1);
+	  if(fNCoherentGroups == 0 || plane != prevPlane || nInGroup == fNChannelsPerCoherentGroup[plane]) {
+	    ++fNCoherentGroups; //new group
+	    nInGroup = 0;
+	  }
+	  fChannelGroupMap[chan] = fNCoherentGroups-1;
+	  ++nInGroup;
+	  prevPlane = plane;
 	}
 }
 
@@ -548,16 +713,26 @@ unsigned int SBNDuBooNEDataDrivenNoiseService::getGroupNumberFromOfflineChannel(
   return fChannelGroupMap[offlinechan];
 }
 
-//**********************************************************************
-unsigned int SBNDuBooNEDataDrivenNoiseService::getCohNoiseChanFromGroup(unsigned int cohgroup) const {
-  return fGroupCoherentNoiseMap[cohgroup];
-}
-
 //**********************************************************************
 
 void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData const& clockData){
+
+  if(fBatchedNoise) {
+    // one seed per event; each array is then its own stream
+    fBatchSeed = (uint64_t(static_cast<unsigned int>(*m_pran)) << 32) | static_cast<unsigned int>(*m_pran);
+  }
     
-  if(fEnableGaussianNoise) {
+  if(fEnableGaussianNoise && fBatchedNoise) {
+    const uint64_t n = fNoiseArrayPoints;
+    std::unique_ptr<TF1> func;
+    func.reset(makeGaussianNoiseFunction(fGausNormU, fGausMeanU, fGausSigmaU));
+    generateBatchedNoise(clockData, fGausNoiseU, fNoiseArrayPoints, func.get(), 0*n, fGausNoiseHistU);
+    func.reset(makeGaussianNoiseFunction(fGausNormV, fGausMeanV, fGausSigmaV));
+    generateBatchedNoise(clockData, fGausNoiseV, fNoiseArrayPoints, func.get(), 1*n, fGausNoiseHistV);
+    func.reset(makeGaussianNoiseFunction(fGausNormZ, fGausMeanZ, fGausSigmaZ));
+    generateBatchedNoise(clockData, fGausNoiseZ, fNoiseArrayPoints, func.get(), 2*n, fGausNoiseHistZ);
+  }
+  else if(fEnableGaussianNoise) {
     fGausNoiseU.resize(fNoiseArrayPoints);
     fGausNoiseV.resize(fNoiseArrayPoints);
     fGausNoiseZ.resize(fNoiseArrayPoints);
@@ -568,34 +743,27 @@ void SBNDuBooNEDataDrivenNoiseService::generateNoise(detinfo::DetectorClocksData
     }
   }
   
-  if(fEnableCoherentNoise) {
-    // U plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[0]);
-    fCohNoiseU.resize(fCohNoiseArrayPoints); 
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseU[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
-    }
-    
-    // V plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[1]);
-    fCohNoiseV.resize(fCohNoiseArrayPoints);
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-      generateCoherentNoise(clockData, fCohNoiseV[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
+  // one waveform per coherent group, shared by all of its channels
+  if(fEnableCoherentNoise && fBatchedNoise) {
+    // streams after the Gaussian noise ones
+    std::unique_ptr<TF1> func(makeCoherentNoiseFunction(fCohGausNorm, fCohGausMean, fCohGausSigma,
+                                                        fCohExpNorm, fCohExpWidth, fCohExpOffset));
+    generateBatchedNoise(clockData, fCohGroupNoise, fNCoherentGroups, func.get(),
+                         3*uint64_t(fNoiseArrayPoints), fCohNoiseHist);
+  }
+  else if(fEnableCoherentNoise) {
+    fCohGroupNoise.resize(fNCoherentGroups);
+    for ( unsigned int i=0; i<fNCoherentGroups; ++i ) {
+      generateCoherentNoise(clockData, fCohGroupNoise[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
                             fCohExpNorm, fCohExpWidth, fCohExpOffset, 
                             fCohNoiseHist);
     }
+  }
 
-    // Z plane
-    makeCoherentGroupsByOfflineChannel(fNChannelsPerCoherentGroup[2]);
-    fCohNoiseZ.resize(fCohNoiseArrayPoints);
-    for ( unsigned int i=0; i<fCohNoiseArrayPoints; ++i ) {
-
-      generateCoherentNoise(clockData, fCohNoiseZ[i], fCohGausNorm, fCohGausMean, fCohGausSigma, 
-                            fCohExpNorm, fCohExpWidth, fCohExpOffset, 
-                            fCohNoiseHist);
-    }
+  if(fEnableCoherentNoise) {
+    mf::LogInfo("SBNDuBooNEDataDrivenNoiseService")
+      << "Coherent noise: " << fNCoherentGroups << " FFTs for " << fChannelGroupMap.size()
+      << " channels, " << fChannelGroupMap.size() - fNCoherentGroups << " FFTs saved";
   }
 }
 
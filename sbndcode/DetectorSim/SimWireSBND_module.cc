@@ -15,6 +15,13 @@
 #include <sstream>
 #include <fstream>
 #include <bitset>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <thread>
 
 extern "C" {
 #include <sys/types.h>
@@ -42,6 +49,9 @@ extern "C" {
 #include "lardataobj/RawData/TriggerData.h"
 #include "lardata/DetectorInfoServices/DetectorClocksService.h"
 #include "sbndcode/Utilities/SignalShapingServiceSBND.h"
+#include "sbndcode/Utilities/FFTPlanCacheSBND.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
+#include "sbndcode/Utilities/ThreadUtilsSBND.h"
 #include "larcore/Geometry/Geometry.h"
 #include "lardataobj/Simulation/sim.h"
 #include "lardataobj/Simulation/SimChannel.h"
@@ -81,6 +91,68 @@ public:
 
 private:
 
+  // Input of one channel for the parallel pass, prepared in the main thread.
+  struct ChannelJob {
+    raw::ChannelID_t            chan;
+    const sim::SimChannel*      sc;           ///< nullptr if the channel has no signal
+    const util::SignalShaping*  shaping;      ///< convolution kernel of the channel
+    int                         timeOffset;   ///< field response time offset (ticks)
+    float                       ped_mean;
+    float                       preamp_sat;
+    std::vector<float>          noise;
+  };
+
+  // A block of consecutive channels and the digits made from them.
+  struct ChannelBlock {
+    std::vector<ChannelJob>     jobs;
+    size_t                      nJobs = 0;
+    std::vector<raw::RawDigit>  digits;
+  };
+
+  // Work buffers owned by one worker thread.
+  struct Workspace {
+    Workspace(size_t nticks, unsigned int nsamples, std::string const& fftOption, unsigned slot)
+      : fft(nticks, fftOption, slot), fftOption(fftOption), slot(slot), chargeWork(nticks, 0.), adcvec(nsamples, 0) {}
+    util::FFTWorkspaceSBND fft;
+    std::string            fftOption;
+    unsigned               slot;        ///< FFT plan cache slot of the worker
+    std::vector<double>    chargeWork;
+    std::vector<short>     adcvec;
+    // sparse convolution
+    std::vector<std::pair<int, double>>                  charges;   ///< (tick, electrons), by tick
+    std::vector<std::pair<size_t, size_t>>               rois;      ///< ranges in charges
+    std::vector<double>                                  roiWork;
+    std::map<int, std::unique_ptr<util::FFTWorkspaceSBND>> roiFFT;  ///< by FFT size
+  };
+
+  // Response of one plane truncated to where it is above tolerance, with its
+  // spectrum for every FFT size the sparse convolution may use.
+  struct SparseKernel {
+    int                                   minLag = 0;  ///< first tick of the response relative to the charge
+    int                                   maxLag = 0;  ///< last tick of the response relative to the charge
+    std::map<int, std::vector<TComplex>>  spectra;     ///< by FFT size
+  };
+
+  void ProduceParallel(detinfo::DetectorClocksData const& clockData,
+                       std::vector<const sim::SimChannel*> const& channels,
+                       std::vector<raw::RawDigit>& digits);
+  unsigned int PrepareBlock(detinfo::DetectorClocksData const& clockData,
+                            std::vector<const sim::SimChannel*> const& channels,
+                            unsigned int firstChan, ChannelBlock& block);
+  void ProcessJob(detinfo::DetectorClocksData const& clockData, ChannelJob const& job,
+                  raw::RawDigit& digit, Workspace& ws) const;
+
+  void CollectCharge(sim::SimChannel const& sc, std::vector<std::pair<int, double>>& charges) const;
+  void SimulateCharge(sim::SimChannel const& sc, util::SignalShaping const& shaping,
+                      int timeOffset, Workspace& ws) const;
+  bool ConvoluteSparse(SparseKernel const& kernel, Workspace& ws) const;
+  void BuildSparseKernels(util::SignalShaping const& shaping, std::string const& fftOption);
+  void ChannelPedestal(raw::ChannelID_t chan, float& ped_mean, float& preamp_sat);
+  void FillNoiseDist(std::vector<float> const& noise);
+  raw::RawDigit MakeDigit(raw::ChannelID_t chan, std::vector<double> const& chargeWork,
+                          std::vector<float> const& noise, float ped_mean, float preamp_sat,
+                          std::vector<short>& adcvec) const;
+
   std::string            fDriftEModuleLabel;///< module making the ionization electrons
   raw::Compress_t        fCompression;      ///< compression type to use
 
@@ -93,6 +165,15 @@ private:
   float                  fBaselineRMS;      ///< ADC value of baseline RMS within each channel
   TH1D*                  fNoiseDist;        ///< distribution of noise counts
   bool                   fGenNoise;         ///< if True -> Gen Noise. if False -> Skip noise generation entierly
+  unsigned               fNThreads;         ///< threads used to convolve and digitize the channels
+  unsigned               fChannelBlockSize; ///< channels whose noise is drawn ahead of each parallel pass
+  bool                   fSparseConvolution;///< convolve only the regions of the channel with charge
+  double                 fSparseKernelTolerance; ///< response truncation, relative to its peak
+
+  std::vector<int>       fTickTDC;          ///< TDC of each tick in the current event
+  std::map<const util::SignalShaping*, SparseKernel> fSparseKernels;
+
+  std::vector<std::unique_ptr<Workspace>> fWorkspaces; ///< one per worker thread
   
   art::ServiceHandle<ChannelNoiseService> noiseserv;
 
@@ -141,6 +222,11 @@ void SimWireSBND::reconfigure(fhicl::ParameterSet const& p)
   fInductionSat      = p.get< float               >("InductionSat",1247.);
   fBaselineRMS       = p.get< float               >("BaselineRMS");
   fTrigModName       = p.get< std::string         >("TrigModName");
+  fNThreads          = util::ResolveNThreads(p.get< unsigned >("NThreads", 1),
+                                             "SBNDCODE_DETSIM_NTHREADS", "SimWireSBND");
+  fChannelBlockSize  = std::max(1u, p.get< unsigned >("ChannelBlockSize", 256));
+  fSparseConvolution = p.get< bool                >("SparseConvolution", false);
+  fSparseKernelTolerance = p.get< double          >("SparseKernelTolerance", 1e-6);
 
   //Map the Shaping times to the entry position for the noise ADC
   //level in fNoiseFactInd and fNoiseFactColl
@@ -201,13 +287,22 @@ void SimWireSBND::beginJob()
     mf::LogError("SimWireSBND") << "Cannot have number of readout samples "
                                  << "greater than FFTSize!";
 
+  if ( fNThreads > 1 )
+    mf::LogInfo("SimWireSBND") << "Simulating channels on " << fNThreads << " threads";
+  fWorkspaces.clear();
+  for (unsigned i = 0; i < fNThreads; ++i)
+    fWorkspaces.push_back(std::make_unique<Workspace>(fNTicks, fNTimeSamples, fFFT->FFTOptions(),
+                                                      util::FFTPlanCacheSBND::kWorkerSlot + i));
+
   return;
 
 }
 
 //-------------------------------------------------
 void SimWireSBND::endJob()
-{}
+{
+  mf::LogInfo("SimWireSBND") << util::FFTPlanCacheSBND::Summary();
+}
 
 void SimWireSBND::produce(art::Event& evt)
 {
@@ -240,22 +335,35 @@ void SimWireSBND::produce(art::Event& evt)
 
   const auto NChannels = geo->Nchannels();
 
-  // vectors for working
-  std::vector<short>    adcvec(fNTimeSamples, 0);
-  std::vector<double>   chargeWork(fNTicks, 0.);
-
+  // TDC of each tick, to read the SimChannels through their own TDC maps
+  fTickTDC.resize(fNTicks);
+  for (size_t t = 0; t < fNTicks; ++t) fTickTDC[t] = clockData.TPCTick2TDC(t);
 
+  // the truncated responses only depend on the (job-wide) shaping
+  if ( fSparseConvolution && fSparseKernels.empty() ) {
+    for (unsigned int c = 0; c < NChannels; ++c)
+      BuildSparseKernels(sss->SignalShaping(c), fWorkspaces[0]->fftOption);
+  }
 
   // make a unique_ptr of sim::SimDigits that allows ownership of the produced
   // digits to be transferred to the art::Event after the put statement below
   std::unique_ptr< std::vector<raw::RawDigit>> digcol(new std::vector<raw::RawDigit>);
   digcol->reserve(NChannels);
 
+  if ( fNThreads > 1 ) {
+    ProduceParallel(clockData, channels, *digcol);
+    evt.put(std::move(digcol));
+    return;
+  }
+
+  // vectors for working
+  Workspace&            ws = *fWorkspaces[0];
+  std::vector<short>&   adcvec = ws.adcvec;
+  std::vector<double>&  chargeWork = ws.chargeWork;
+
   unsigned int chan = 0;
-  art::ServiceHandle<util::LArFFT> fFFT;
-     
+
   //LOOP OVER ALL CHANNELS
-  std::map<int, double>::iterator mapIter;
   for (chan = 0; chan < geo->Nchannels(); chan++) {
 
     if (channelStatus.IsBad(chan)) continue;
@@ -265,83 +373,345 @@ void SimWireSBND::produce(art::Event& evt)
     std::fill(chargeWork.begin(), chargeWork.end(), 0.);
     if ( sc ) {
 
-      // loop over the tdcs and grab the number of electrons for each
-      for (int t = 0; t < (int)(chargeWork.size()); ++t) {
+      // Convolve charge with appropriate response function
+      SimulateCharge(*sc, sss->SignalShaping(chan), sss->FieldResponseTOffset(clockData, chan), ws);
+
+    }
+    std::vector<float> noisetmp(fNTicks, 0.);
 
-        int tdc = clockData.TPCTick2TDC(t);
+    // Add noise to channel.
+    if( fGenNoise ) noiseserv->addNoise(clockData, chan,noisetmp);
+    FillNoiseDist(noisetmp);
 
-        // continue if tdc < 0
-        if ( tdc < 0 ) continue;
+    //Pedestal determination
+    float ped_mean, preamp_sat;
+    ChannelPedestal(chan, ped_mean, preamp_sat);
 
-        chargeWork.at(t) = sc->Charge(tdc);
+    // add this digit to the collection
+    digcol->push_back(MakeDigit(chan, chargeWork, noisetmp, ped_mean, preamp_sat, adcvec));
 
+  }// end loop over channels
+
+  evt.put(std::move(digcol));
+
+}//produce()
+
+//-------------------------------------------------
+// Channel loop split over fNThreads threads.
+// The pedestal and noise draws stay in the main thread, in channel order and
+// with the service random engines, so that the output is identical to the
+// serial loop whatever the number of threads. While the workers convolve and
+// digitize one block of channels, the main thread draws the noise of the next.
+void SimWireSBND::ProduceParallel(detinfo::DetectorClocksData const& clockData,
+                                  std::vector<const sim::SimChannel*> const& channels,
+                                  std::vector<raw::RawDigit>& digits)
+{
+  ChannelBlock blocks[2];
+  unsigned int nextChan = PrepareBlock(clockData, channels, 0, blocks[0]);
+
+  for (unsigned cur = 0; blocks[cur].nJobs > 0; cur = 1 - cur) {
+    ChannelBlock& block = blocks[cur];
+    block.digits.clear();
+    block.digits.resize(block.nJobs);
+
+    // one thread is kept for the noise of the next block
+    std::exception_ptr workerError;
+    std::thread driver([&]() {
+      try {
+        util::ParallelForEach(fNThreads - 1, block.nJobs, [&](size_t iJob, unsigned worker) {
+          ProcessJob(clockData, block.jobs[iJob], block.digits[iJob], *fWorkspaces[worker]);
+        });
+      }
+      catch (...) {
+        workerError = std::current_exception();
       }
+    });
 
-      // Convolve charge with appropriate response function
-      sss->Convolute(clockData, chan, chargeWork);
+    std::exception_ptr prepareError;
+    try {
+      nextChan = PrepareBlock(clockData, channels, nextChan, blocks[1 - cur]);
+    }
+    catch (...) {
+      prepareError = std::current_exception();
+    }
+    driver.join();
+
+    if (workerError) std::rethrow_exception(workerError);
+    if (prepareError) std::rethrow_exception(prepareError);
+
+    std::move(block.digits.begin(), block.digits.end(), std::back_inserter(digits));
+  }
+}
+
+//-------------------------------------------------
+// Collect the next fChannelBlockSize good channels starting at firstChan,
+// with everything that needs services or random numbers.
+// Returns the first channel of the following block.
+unsigned int SimWireSBND::PrepareBlock(detinfo::DetectorClocksData const& clockData,
+                                       std::vector<const sim::SimChannel*> const& channels,
+                                       unsigned int firstChan, ChannelBlock& block)
+{
+  art::ServiceHandle<util::SignalShapingServiceSBND> sss;
+  lariov::ChannelStatusProvider const& channelStatus(art::ServiceHandle<lariov::ChannelStatusService const>()->GetProvider());
+
+  block.nJobs = 0;
+  unsigned int chan = firstChan;
+  for (; chan < channels.size() && block.nJobs < fChannelBlockSize; ++chan) {
 
+    if (channelStatus.IsBad(chan)) continue;
+
+    if (block.jobs.size() <= block.nJobs) block.jobs.emplace_back();
+    ChannelJob& job = block.jobs[block.nJobs++];
+
+    job.chan = chan;
+    job.sc = channels[chan];
+    job.shaping = nullptr;
+    job.timeOffset = 0;
+    if ( job.sc ) {
+      job.shaping = &sss->SignalShaping(chan);
+      job.timeOffset = sss->FieldResponseTOffset(clockData, chan);
     }
-    std::vector<float> noisetmp(fNTicks, 0.);
 
-    // Add noise to channel.
-    if( fGenNoise ) noiseserv->addNoise(clockData, chan,noisetmp);
+    job.noise.assign(fNTicks, 0.);
 
-    //Pedestal determination
-    float ped_mean = fCollectionPed;
-    float preamp_sat=fCollectionSat;
-    geo::SigType_t sigtype = geo->SignalType(chan);
-    if (sigtype == geo::kInduction) {
-      ped_mean = fInductionPed;
-      preamp_sat = fInductionSat;
+    ChannelPedestal(chan, job.ped_mean, job.preamp_sat);
+  }
+
+  // noise for the whole block in one call, in channel order
+  if( fGenNoise ) {
+    std::vector<ChannelNoiseService::Channel> chans(block.nJobs);
+    std::vector<AdcSignalVector*> noise(block.nJobs);
+    for (unsigned int iJob = 0; iJob < block.nJobs; ++iJob) {
+      chans[iJob] = block.jobs[iJob].chan;
+      noise[iJob] = &block.jobs[iJob].noise;
     }
-    //slight variation on ped on order of RMS of baseline variation
-    // (skip this if BaselineRMS = 0 in fhicl)
-    if( fBaselineRMS ) {
-      CLHEP::RandGaussQ rGaussPed(fPedestalEngine, 0.0, fBaselineRMS);
-      ped_mean += rGaussPed.fire();
+    noiseserv->addNoiseBlock(clockData, chans, noise);
+  }
+  for (unsigned int iJob = 0; iJob < block.nJobs; ++iJob) FillNoiseDist(block.jobs[iJob].noise);
+
+  return chan;
+}
+
+//-------------------------------------------------
+// Convolve and digitize one channel; runs in a worker thread.
+void SimWireSBND::ProcessJob(detinfo::DetectorClocksData const& clockData, ChannelJob const& job,
+                             raw::RawDigit& digit, Workspace& ws) const
+{
+  std::fill(ws.chargeWork.begin(), ws.chargeWork.end(), 0.);
+  if ( job.sc ) SimulateCharge(*job.sc, *job.shaping, job.timeOffset, ws);
+
+  digit = MakeDigit(job.chan, ws.chargeWork, job.noise, job.ped_mean, job.preamp_sat, ws.adcvec);
+}
+
+//-------------------------------------------------
+// Number of electrons on each tick with charge, walking the TDC map of the
+// SimChannel instead of looking up every tick of the readout.
+void SimWireSBND::CollectCharge(sim::SimChannel const& sc,
+                                std::vector<std::pair<int, double>>& charges) const
+{
+  charges.clear();
+  for (auto const& tdcide : sc.TDCIDEMap()) {
+
+    // ticks reading out this tdc (ticks with tdc < 0 never match)
+    auto const ticks = std::equal_range(fTickTDC.begin(), fTickTDC.end(), (int) tdcide.first);
+    if (ticks.first == ticks.second) continue;
+
+    double charge = 0.;
+    for (auto const& ide : tdcide.second) charge += ide.numElectrons;
+
+    for (auto tick = ticks.first; tick != ticks.second; ++tick)
+      charges.emplace_back(tick - fTickTDC.begin(), charge);
+  }
+}
+
+//-------------------------------------------------
+// Fill ws.chargeWork (all zeros on input) with the convolved charge of one
+// channel, using only the FFT workspaces in ws.
+void SimWireSBND::SimulateCharge(sim::SimChannel const& sc, util::SignalShaping const& shaping,
+                                 int timeOffset, Workspace& ws) const
+{
+  CollectCharge(sc, ws.charges);
+  if (ws.charges.empty()) return;
+
+  if ( fSparseConvolution ) {
+    auto const kernel = fSparseKernels.find(&shaping);
+    if ( kernel != fSparseKernels.end() && ConvoluteSparse(kernel->second, ws) ) {
+      util::SignalShapingServiceSBND::ShiftConvoluted(timeOffset, ws.chargeWork);
+      return;
     }
+  }
 
-    for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+  for (auto const& charge : ws.charges) ws.chargeWork[charge.first] = charge.second;
+  util::SignalShapingServiceSBND::Convolute(shaping, timeOffset, ws.chargeWork, ws.fft);
+}
 
-      float chargecontrib = chargeWork.at(i);
-      if (chargecontrib>preamp_sat) chargecontrib=preamp_sat;
+//-------------------------------------------------
+// Convolve the charge in ws.charges with the truncated response, one region
+// of interest at a time, adding the result to ws.chargeWork. Charges closer
+// than the response length share a region. Returns false without touching
+// ws.chargeWork when the regions would cost more than one full transform.
+bool SimWireSBND::ConvoluteSparse(SparseKernel const& kernel, Workspace& ws) const
+{
+  if (kernel.spectra.empty()) return false;
 
-      float adcval = noisetmp.at(i) + chargecontrib + ped_mean;
+  const int span = kernel.maxLag - kernel.minLag;
+  const int maxSize = kernel.spectra.rbegin()->first;
 
-      //Add Noise to NoiseDist Histogram
-      if (i % 100 == 0)
-        fNoiseDist->Fill(noisetmp.at(i));
+  ws.rois.clear();
+  size_t first = 0;
+  int totalSize = 0;
+  for (size_t i = 1; i <= ws.charges.size(); ++i) {
+    if (i < ws.charges.size() && ws.charges[i].first - ws.charges[i-1].first <= span) continue;
 
-      //allow for ADC saturation
-      if ( adcval > adcsaturation )
-        adcval = adcsaturation;
-      //don't allow for "negative" saturation
-      if ( adcval < 0 )
-        adcval = 0;
+    const int length = ws.charges[i-1].first - ws.charges[first].first + 1 + span;
+    if (length > maxSize) return false;
+    totalSize += kernel.spectra.lower_bound(length)->first;
+    if (totalSize >= (int) fNTicks) return false;
 
-      adcvec.at(i) = (unsigned short)(adcval+0.5);
+    ws.rois.emplace_back(first, i);
+    first = i;
+  }
 
-    }// end loop over signal size
+  const int nticks = fNTicks;
+  for (auto const& roi : ws.rois) {
+    const int start = ws.charges[roi.first].first;
+    const int length = ws.charges[roi.second-1].first - start + 1 + span;
+    auto const spectrum = kernel.spectra.lower_bound(length);
+    const int size = spectrum->first;
 
-    // resize the adcvec to be the correct number of time samples,
-    // just drop the extra samples
-    //adcvec.resize(fNTimeSamples);
+    auto& fft = ws.roiFFT[size];
+    if (!fft) fft = std::make_unique<util::FFTWorkspaceSBND>(size, ws.fftOption, ws.slot);
 
-    // compress the adc vector using the desired compression scheme,
-    // if raw::kNone is selected nothing happens to adcvec
-    // This shrinks adcvec, if fCompression is not kNone.
-    raw::Compress(adcvec, fCompression);
+    ws.roiWork.assign(size, 0.);
+    for (size_t i = roi.first; i < roi.second; ++i)
+      ws.roiWork[ws.charges[i].first - start] = ws.charges[i].second;
 
-    // add this digit to the collection
-    raw::RawDigit rd(chan, fNTimeSamples, adcvec, fCompression);
-    rd.SetPedestal(ped_mean);
-    digcol->push_back(rd);
+    fft->Convolute(ws.roiWork, spectrum->second);
 
-  }// end loop over channels
+    // output sample o is at tick start + minLag + o, wrapped around the
+    // readout as the full-length circular convolution does
+    for (int o = 0; o < length; ++o) {
+      int tick = (start + kernel.minLag + o) % nticks;
+      if (tick < 0) tick += nticks;
+      ws.chargeWork[tick] += ws.roiWork[o];
+    }
+  }
 
-  evt.put(std::move(digcol));
+  return true;
+}
 
-}//produce()
+//-------------------------------------------------
+// Truncate the time-domain response of a plane and cache its padded spectrum
+// for every power-of-two FFT size up to half the full transform.
+void SimWireSBND::BuildSparseKernels(util::SignalShaping const& shaping, std::string const& fftOption)
+{
+  if (fSparseKernels.count(&shaping)) return;
+  SparseKernel& kernel = fSparseKernels[&shaping];
+
+  const int nticks = fNTicks;
+  util::FFTWorkspaceSBND fft(nticks, fftOption);
+  std::vector<double> response(nticks, 0.);
+  fft.DoInvFFT(shaping.ConvKernel(), response);
+
+  double peak = 0.;
+  for (double r : response) peak = std::max(peak, std::abs(r));
+  const double threshold = fSparseKernelTolerance * peak;
+
+  // ticks past half the readout are the tail at negative lags
+  bool found = false;
+  for (int k = 0; k < nticks; ++k) {
+    if (std::abs(response[k]) <= threshold) continue;
+    const int lag = (k <= nticks/2) ? k : k - nticks;
+    kernel.minLag = found ? std::min(kernel.minLag, lag) : lag;
+    kernel.maxLag = found ? std::max(kernel.maxLag, lag) : lag;
+    found = true;
+  }
+  if (!found) return;
+
+  const int span = kernel.maxLag - kernel.minLag;
+  std::vector<double> padded;
+  for (int size = 64; size <= nticks/2; size *= 2) {
+    if (size <= span) continue;
+
+    padded.assign(size, 0.);
+    for (int j = 0; j <= span; ++j) {
+      int k = (j + kernel.minLag) % nticks;
+      if (k < 0) k += nticks;
+      padded[j] = response[k];
+    }
+
+    util::FFTWorkspaceSBND roiFFT(size, fftOption);
+    roiFFT.DoFFT(padded, kernel.spectra[size]);
+  }
+
+  mf::LogInfo("SimWireSBND") << "Sparse convolution response spans ticks ["
+                             << kernel.minLag << ", " << kernel.maxLag << "], "
+                             << kernel.spectra.size() << " cached FFT sizes";
+}
+
+//-------------------------------------------------
+void SimWireSBND::ChannelPedestal(raw::ChannelID_t chan, float& ped_mean, float& preamp_sat)
+{
+  art::ServiceHandle<geo::Geometry> geo;
+
+  ped_mean = fCollectionPed;
+  preamp_sat=fCollectionSat;
+  geo::SigType_t sigtype = geo->SignalType(chan);
+  if (sigtype == geo::kInduction) {
+    ped_mean = fInductionPed;
+    preamp_sat = fInductionSat;
+  }
+  //slight variation on ped on order of RMS of baseline variation
+  // (skip this if BaselineRMS = 0 in fhicl)
+  if( fBaselineRMS ) {
+    CLHEP::RandGaussQ rGaussPed(fPedestalEngine, 0.0, fBaselineRMS);
+    ped_mean += rGaussPed.fire();
+  }
+}
+
+//-------------------------------------------------
+void SimWireSBND::FillNoiseDist(std::vector<float> const& noise)
+{
+  //Add Noise to NoiseDist Histogram
+  for (unsigned int i = 0; i < fNTimeSamples; i += 100)
+    fNoiseDist->Fill(noise.at(i));
+}
+
+//-------------------------------------------------
+raw::RawDigit SimWireSBND::MakeDigit(raw::ChannelID_t chan, std::vector<double> const& chargeWork,
+                                     std::vector<float> const& noise, float ped_mean, float preamp_sat,
+                                     std::vector<short>& adcvec) const
+{
+  // the previous compression may have shrunk the vector
+  adcvec.resize(fNTimeSamples);
+
+  for (unsigned int i = 0; i < fNTimeSamples; ++i) {
+
+    float chargecontrib = chargeWork.at(i);
+    if (chargecontrib>preamp_sat) chargecontrib=preamp_sat;
+
+    float adcval = noise.at(i) + chargecontrib + ped_mean;
+
+    //allow for ADC saturation
+    if ( adcval > adcsaturation )
+      adcval = adcsaturation;
+    //don't allow for "negative" saturation
+    if ( adcval < 0 )
+      adcval = 0;
+
+    adcvec.at(i) = (unsigned short)(adcval+0.5);
+
+  }// end loop over signal size
+
+  // compress the adc vector using the desired compression scheme,
+  // if raw::kNone is selected nothing happens to adcvec
+  // This shrinks adcvec, if fCompression is not kNone.
+  raw::Compress(adcvec, fCompression);
+
+  raw::RawDigit rd(chan, fNTimeSamples, adcvec, fCompression);
+  rd.SetPedestal(ped_mean);
+  return rd;
+}
 
 
 
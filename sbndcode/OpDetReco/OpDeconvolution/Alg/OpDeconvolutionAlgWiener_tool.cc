@@ -12,10 +12,14 @@
 #include "art/Utilities/ToolMacros.h"
 #include "art/Utilities/make_tool.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 
 #include "lardataobj/RawData/OpDetWaveform.h"
-#include "lardata/Utilities/LArFFT.h"
+#include "sbndcode/Utilities/BaselineUtilsSBND.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
+#include "sbndcode/Utilities/ThreadUtilsSBND.h"
 #include "TFile.h"
 
 #include <cmath>
@@ -68,11 +72,36 @@ private:
   size_t MaxBinsFFT;
 
   unsigned int NDecoWf;
+  unsigned int fNThreads;
 
   TF1 *fFilterTF1;
   std::vector<double> fSignalHypothesis;
   std::vector<double> fNoiseHypothesis;
 
+  //Kernel cache: kernels are kept by (FFT size, noise power bin), the
+  //response and hypothesis spectra by FFT size
+  double fKernelCacheStep;
+  size_t fKernelCacheMaxSize;
+  struct ResponseSpectra {
+    std::vector<TComplex> ser;
+    std::vector<TComplex> hypo;
+  };
+  std::map<size_t, ResponseSpectra> fResponseSpectra;
+  using Kernel = std::shared_ptr<std::vector<TComplex> const>;
+  std::map<std::pair<size_t, long>, Kernel> fKernelCache;
+  unsigned long fNKernelsBuilt;
+  unsigned long fNKernelsReused;
+  std::mutex fKernelMutex; ///< guards the spectra and the kernel cache
+
+  //FFT workspaces of each worker, by FFT size
+  std::vector<std::map<size_t, std::unique_ptr<util::FFTWorkspaceSBND>>> fWorkspaces;
+  //baseline histograms of each worker
+  struct BaselineHistograms {
+    util::ModeHistogramSBND stddev;
+    util::ModeHistogramSBND mean;
+  };
+  std::vector<BaselineHistograms> fBaselineHists;
+
   // Declare member data here.
 
   // Declare member functions
@@ -81,13 +110,15 @@ private:
   size_t WfSizeFFT(size_t n);
   std::vector<double> ScintArrivalTimesShape(size_t n, detinfo::LArProperties const& lar_prop);
   void SubtractBaseline(std::vector<double> &wf, double baseline);
-  void EstimateBaselineStdDev(std::vector<double> &wf, double &_mean, double &_stddev);
-  std::vector<TComplex> DeconvolutionKernel(size_t size, double baseline_stddev, double snr_scaling);
+  void EstimateBaselineStdDev(std::vector<double> &wf, double &_mean, double &_stddev, size_t wfIndex, unsigned worker);
+  bool DeconvolveWaveform(raw::OpDetWaveform const& wf, size_t wfIndex, unsigned worker, raw::OpDetWaveform& decowf);
+  util::FFTWorkspaceSBND& Workspace(size_t size, unsigned worker);
+  ResponseSpectra const& GetResponseSpectra(size_t size, unsigned worker);
+  Kernel DeconvolutionKernel(size_t size, double baseline_stddev, double snr_scaling, size_t wfIndex, unsigned worker);
+  void BuildKernel(size_t size, double noise_power, size_t wfIndex, unsigned worker, std::vector<TComplex>& kernel);
 
   //Load TFileService serrvice
   art::ServiceHandle<art::TFileService> tfs;
-  //Load FFT serrvice
-  art::ServiceHandle<util::LArFFT> fft_service;
 };
 
 
@@ -115,9 +146,21 @@ opdet::OpDeconvolutionAlgWiener::OpDeconvolutionAlgWiener(fhicl::ParameterSet co
   fScaleHypoSignal = p.get< bool >("ScaleHypoSignal");
   fUseParamFilter = p.get< bool >("UseParamFilter");
   fFilterParams = p.get< std::vector<double> >("FilterParams");
+  fKernelCacheStep = p.get< double >("KernelCacheStep", 0.);
+  fKernelCacheMaxSize = p.get< size_t >("KernelCacheMaxSize", 256);
+  fNThreads = util::ResolveNThreads(p.get< unsigned >("NThreads", 1),
+                                    "SBNDCODE_OPDECO_NTHREADS", "OpDeconvolutionAlg");
+  if(fDebug && fNThreads>1){
+    mf::LogWarning("OpDeconvolutionAlg")<<"Debug histograms are made one waveform at a time...using 1 thread"<<std::endl;
+    fNThreads=1;
+  }
+  fWorkspaces.resize(fNThreads);
+  fBaselineHists.resize(fNThreads);
 
   fNormUnAvSmooth=1./(2*fUnAvNeighbours+1);
   NDecoWf=0;
+  fNKernelsBuilt=0;
+  fNKernelsReused=0;
   MaxBinsFFT=std::pow(2, fMaxFFTSizePow);
 
   auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
@@ -158,83 +201,108 @@ opdet::OpDeconvolutionAlgWiener::OpDeconvolutionAlgWiener(fhicl::ParameterSet co
 
 std::vector<raw::OpDetWaveform> opdet::OpDeconvolutionAlgWiener::RunDeconvolution(std::vector<raw::OpDetWaveform> const& wfVector)
 {
+  //Waveforms are independent: they are deconvolved by up to fNThreads
+  //workers into their slot of the output, then the skipped ones are
+  //dropped keeping the input order
+  std::vector<raw::OpDetWaveform> decoSlots(wfVector.size());
+  std::vector<char> decoDone(wfVector.size(), 0);
+
+  util::ParallelForEach(fNThreads, wfVector.size(), [&](size_t ix, unsigned worker){
+    decoDone[ix]=DeconvolveWaveform(wfVector[ix], NDecoWf+ix, worker, decoSlots[ix]);
+  });
+
   std::vector<raw::OpDetWaveform> wfDeco;
   wfDeco.reserve(wfVector.size());
+  for(size_t ix=0; ix<wfVector.size(); ix++){
+    if(decoDone[ix])
+      wfDeco.push_back(std::move(decoSlots[ix]));
+  }
+  NDecoWf+=wfVector.size();
 
-  for(auto const& wf : wfVector)
-  {
-    //Read waveform
-    size_t wfsize=wf.Waveform().size();
-    if(wfsize>MaxBinsFFT){
-      mf::LogWarning("OpDeconvolutionAlg")<<"Skipping waveform...waveform size is"<<wfsize<<"...maximum allowed FFT size is="<<MaxBinsFFT<<std::endl;
-      continue;
-    }
-    mf::LogInfo("OpDeconvolutionAlg")<<"Deconvolving waveform:"<<NDecoWf<<"...size="<<wfsize<<std::endl;
-    size_t wfsizefft=WfSizeFFT(wfsize);
-
-    std::vector<double> wave;
-    wave.reserve(wfsizefft);
-    wave.assign(wf.Waveform().begin(), wf.Waveform().end());
-
-    //Reserve minimum ADCC value for Wiener filter
-    double minADC=*min_element(wave.begin(), wave.end());
-
-    //Apply waveform smoothing
-    if(fApplyExpoAvSmooth)
-      ApplyExpoAvSmoothing(wave);
-    if(fApplyUnAvSmooth)
-      ApplyUnAvSmoothing(wave);
-
-    //Estimate baseline standrd deviation
-    double baseline_mean=0., baseline_stddev=1.;
-    EstimateBaselineStdDev(wave, baseline_mean, baseline_stddev);
-    double wfPeakPE=fHypoSignalScale*(baseline_mean-minADC)/fPMTChargeToADC;
-    SubtractBaseline(wave, baseline_mean);
-
-    //Create deconvolution kernel
-    wave.resize(wfsizefft, 0);
-    std::vector<TComplex> fDeconvolutionKernel=DeconvolutionKernel(wfsize, baseline_stddev, wfPeakPE);
-
-    //Deconvolve raw signal (covolve with kernel)
-    fft_service->ReinitializeFFT(wfsizefft, "", 20);
-    fft_service->Convolute(wave, fDeconvolutionKernel);
-    wave.resize(wfsize);
-
-    //Set deconvlved waveform precision and restore baseline before saving
-    EstimateBaselineStdDev(wave, baseline_mean, baseline_stddev);
-    SubtractBaseline(wave, baseline_mean);
-    double fDecoWfScaleFactor=1./fDecoWaveformPrecision;
-    std::transform(wave.begin(), wave.end(), wave.begin(), [fDecoWfScaleFactor](double &dec){ return fDecoWfScaleFactor*dec; } );
-
-    //Debbuging and save wf in hist file
-    if(fDebug){
-      std::cout<<".....Debbuging.....\n";
-      auto minADC_ix=min_element(wave.begin(), wave.end());
-      std::cout<<"Stamp="<<wf.TimeStamp()<<" OpCh"<<wf.ChannelNumber()<<" MinADC="<<minADC<<" (";
-      std::cout<<minADC_ix-wave.begin()<<") Size="<<wf.Waveform().size()<<" ScFactor="<<wfPeakPE<<"\n\n";
-
-      std::string name="h_deco"+std::to_string(NDecoWf)+"_"+std::to_string(wf.ChannelNumber())+"_"+std::to_string(wf.TimeStamp());
-      TH1F * h_deco = tfs->make< TH1F >(name.c_str(),";Bin;#PE", MaxBinsFFT, 0, MaxBinsFFT);
-      for(size_t k=0; k<wave.size(); k++){
-        //if(fDebug) std::cout<<k<<":"<<wave[k]<<":"<<rawsignal[k]<<"  ";
-        h_deco->Fill(k, wave[k]);
-      }
-
-      name="h_raw"+std::to_string(NDecoWf)+"_"+std::to_string(wf.ChannelNumber())+"_"+std::to_string(wf.TimeStamp());
-      TH1F * h_raw = tfs->make< TH1F >(name.c_str(),";Bin;ADC", MaxBinsFFT, 0, MaxBinsFFT);
-      for(size_t k=0; k<wf.Waveform().size(); k++){
-        //if(fDebug) std::cout<<k<<":"<<wave[k]<<":"<<rawsignal[k]<<"  ";
-        h_raw->Fill(k, wf.Waveform()[k]);
-      }
+  mf::LogInfo("OpDeconvolutionAlg")<<"Deconvolution kernels built="<<fNKernelsBuilt<<" reused="<<fNKernelsReused<<std::endl;
+
+  return wfDeco;
+}
+
+
+bool opdet::OpDeconvolutionAlgWiener::DeconvolveWaveform(raw::OpDetWaveform const& wf, size_t wfIndex, unsigned worker, raw::OpDetWaveform& decowf)
+{
+  //Read waveform
+  size_t wfsize=wf.Waveform().size();
+  if(wfsize>MaxBinsFFT){
+    mf::LogWarning("OpDeconvolutionAlg")<<"Skipping waveform...waveform size is"<<wfsize<<"...maximum allowed FFT size is="<<MaxBinsFFT<<std::endl;
+    return false;
+  }
+  mf::LogInfo("OpDeconvolutionAlg")<<"Deconvolving waveform:"<<wfIndex<<"...size="<<wfsize<<std::endl;
+  size_t wfsizefft=WfSizeFFT(wfsize);
+
+  std::vector<double> wave;
+  wave.reserve(wfsizefft);
+  wave.assign(wf.Waveform().begin(), wf.Waveform().end());
+
+  //Reserve minimum ADCC value for Wiener filter
+  double minADC=*min_element(wave.begin(), wave.end());
+
+  //Apply waveform smoothing
+  if(fApplyExpoAvSmooth)
+    ApplyExpoAvSmoothing(wave);
+  if(fApplyUnAvSmooth)
+    ApplyUnAvSmoothing(wave);
+
+  //Estimate baseline standrd deviation
+  double baseline_mean=0., baseline_stddev=1.;
+  EstimateBaselineStdDev(wave, baseline_mean, baseline_stddev, wfIndex, worker);
+  double wfPeakPE=fHypoSignalScale*(baseline_mean-minADC)/fPMTChargeToADC;
+  SubtractBaseline(wave, baseline_mean);
+
+  //Create deconvolution kernel
+  wave.resize(wfsizefft, 0);
+  Kernel fDeconvolutionKernel=DeconvolutionKernel(wfsize, baseline_stddev, wfPeakPE, wfIndex, worker);
+
+  //Deconvolve raw signal (covolve with kernel)
+  Workspace(wfsizefft, worker).Convolute(wave, *fDeconvolutionKernel);
+  wave.resize(wfsize);
+
+  //Set deconvlved waveform precision and restore baseline before saving
+  EstimateBaselineStdDev(wave, baseline_mean, baseline_stddev, wfIndex, worker);
+  SubtractBaseline(wave, baseline_mean);
+  double fDecoWfScaleFactor=1./fDecoWaveformPrecision;
+  std::transform(wave.begin(), wave.end(), wave.begin(), [fDecoWfScaleFactor](double &dec){ return fDecoWfScaleFactor*dec; } );
+
+  //Debbuging and save wf in hist file
+  if(fDebug){
+    std::cout<<".....Debbuging.....\n";
+    auto minADC_ix=min_element(wave.begin(), wave.end());
+    std::cout<<"Stamp="<<wf.TimeStamp()<<" OpCh"<<wf.ChannelNumber()<<" MinADC="<<minADC<<" (";
+    std::cout<<minADC_ix-wave.begin()<<") Size="<<wf.Waveform().size()<<" ScFactor="<<wfPeakPE<<"\n\n";
+
+    std::string name="h_deco"+std::to_string(wfIndex)+"_"+std::to_string(wf.ChannelNumber())+"_"+std::to_string(wf.TimeStamp());
+    TH1F * h_deco = tfs->make< TH1F >(name.c_str(),";Bin;#PE", MaxBinsFFT, 0, MaxBinsFFT);
+    for(size_t k=0; k<wave.size(); k++){
+      //if(fDebug) std::cout<<k<<":"<<wave[k]<<":"<<rawsignal[k]<<"  ";
+      h_deco->Fill(k, wave[k]);
     }
 
-    //raw::OpDetWaveform decowf(wf.TimeStamp(), wf.ChannelNumber(), std::vector<short unsigned int> (wave.begin(),  std::next(wave.begin(), wf.Waveform().size()) ) );
-    raw::OpDetWaveform decowf( wf.TimeStamp(), wf.ChannelNumber(), std::vector<short unsigned int> (wave.begin(),  wave.end()) );
-    wfDeco.push_back(decowf);
-    NDecoWf++;
+    name="h_raw"+std::to_string(wfIndex)+"_"+std::to_string(wf.ChannelNumber())+"_"+std::to_string(wf.TimeStamp());
+    TH1F * h_raw = tfs->make< TH1F >(name.c_str(),";Bin;ADC", MaxBinsFFT, 0, MaxBinsFFT);
+    for(size_t k=0; k<wf.Waveform().size(); k++){
+      //if(fDebug) std::cout<<k<<":"<<wave[k]<<":"<<rawsignal[k]<<"  ";
+      h_raw->Fill(k, wf.Waveform()[k]);
+    }
   }
 
-  return wfDeco;
+  //raw::OpDetWaveform decowf(wf.TimeStamp(), wf.ChannelNumber(), std::vector<short unsigned int> (wave.begin(),  std::next(wave.begin(), wf.Waveform().size()) ) );
+  decowf=raw::OpDetWaveform( wf.TimeStamp(), wf.ChannelNumber(), std::vector<short unsigned int> (wave.begin(),  wave.end()) );
+  return true;
+}
+
+
+util::FFTWorkspaceSBND& opdet::OpDeconvolutionAlgWiener::Workspace(size_t size, unsigned worker)
+{
+  auto& fft=fWorkspaces[worker][size];
+  if(!fft)
+    fft=std::make_unique<util::FFTWorkspaceSBND>(size, "", util::FFTPlanCacheSBND::kWorkerSlot+worker);
+  return *fft;
 }
 
 
@@ -309,12 +377,15 @@ void opdet::OpDeconvolutionAlgWiener::SubtractBaseline(std::vector<double> &wf,
 }
 
 
-void opdet::OpDeconvolutionAlgWiener::EstimateBaselineStdDev(std::vector<double> &wf, double &_mean, double &_stddev){
+void opdet::OpDeconvolutionAlgWiener::EstimateBaselineStdDev(std::vector<double> &wf, double &_mean, double &_stddev, size_t wfIndex, unsigned worker){
   double minADC=*min_element(wf.begin(), wf.end());
   double maxADC=*max_element(wf.begin(), wf.end());
   unsigned nbins=25*ceil(maxADC-minADC);
-  TH1F h_std = TH1F("",";;", nbins, 0, (maxADC-minADC)/2);
-  TH1F h_mean = TH1F("",";;", nbins, minADC, maxADC);
+  //distributions of the local standard deviation and mean of the waveform
+  util::ModeHistogramSBND& h_std = fBaselineHists[worker].stddev;
+  util::ModeHistogramSBND& h_mean = fBaselineHists[worker].mean;
+  h_std.Reset(nbins, 0, (maxADC-minADC)/2);
+  h_mean.Reset(nbins, minADC, maxADC);
 
   for(size_t ix=0; ix<wf.size()-fBaselineSample; ix++){
     double sum2=0, sum=0;
@@ -330,42 +401,109 @@ void opdet::OpDeconvolutionAlgWiener::EstimateBaselineStdDev(std::vector<double>
     //std::cout<<ix<<":"<<wf[ix]<<":"<<sum<<" ";
   }
 
-  _stddev=h_std.GetXaxis()->GetBinCenter(h_std.GetMaximumBin());
-  _mean=h_mean.GetXaxis()->GetBinCenter(h_mean.GetMaximumBin());
+  _stddev=h_std.Mode();
+  _mean=h_mean.Mode();
 
   if(fDebug){
     std::cout<<"   -- Estimating baseline...StdDev: "<<_stddev<<" Bias="<<_mean<<std::endl;
     std::cout<<"      .. "<<minADC<<" "<<maxADC<<" "<<maxADC-minADC<<" "<<ceil(log10(maxADC-minADC))<<" "<<nbins<<"\n";
 
-    std::string name="h_baselinestddev_"+std::to_string(NDecoWf)+std::to_string(_mean);
+    std::string name="h_baselinestddev_"+std::to_string(wfIndex)+std::to_string(_mean);
     TH1F * hs_std = tfs->make< TH1F > (name.c_str(),"Baseline StdDev;ADC;# entries",
-      h_std.GetNbinsX(), h_std.GetXaxis()->GetXmin(), h_std.GetXaxis()->GetXmax());
-    for(int k=1; k<=h_std.GetNbinsX(); k++)
-      hs_std->SetBinContent(k, h_std.GetBinContent(k));
+      h_std.NBins(), h_std.Low(), h_std.High());
+    for(int k=1; k<=h_std.NBins(); k++)
+      hs_std->SetBinContent(k, h_std.Count(k));
 
-    name="h_baselinemean_"+std::to_string(NDecoWf)+std::to_string(_mean);
+    name="h_baselinemean_"+std::to_string(wfIndex)+std::to_string(_mean);
     TH1F * hs_mean = tfs->make< TH1F >(name.c_str(),"Baseline Mean;ADC;# entries",
-      h_mean.GetNbinsX(), h_mean.GetXaxis()->GetXmin(), h_mean.GetXaxis()->GetXmax());
-    for(int k=1; k<=h_mean.GetNbinsX(); k++)
-      hs_mean->SetBinContent(k, h_mean.GetBinContent(k));
+      h_mean.NBins(), h_mean.Low(), h_mean.High());
+    for(int k=1; k<=h_mean.NBins(); k++)
+      hs_mean->SetBinContent(k, h_mean.Count(k));
   }
 
   return;
 }
 
 
-std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_t wfsize, double baseline_stddev, double snr_scaling){
-  //Initizalize kernel
-  size_t size=WfSizeFFT(wfsize);
-  TComplex kerinit(0,0,false);
-  std::vector<TComplex> kernel(size, kerinit);
-  fft_service->ReinitializeFFT (size, "", 20);
+//Called with fKernelMutex held
+opdet::OpDeconvolutionAlgWiener::ResponseSpectra const& opdet::OpDeconvolutionAlgWiener::GetResponseSpectra(size_t size, unsigned worker){
+  auto it=fResponseSpectra.find(size);
+  if(it!=fResponseSpectra.end())
+    return it->second;
+
+  ResponseSpectra& spectra=fResponseSpectra[size];
+  util::FFTWorkspaceSBND& fft=Workspace(size, worker);
 
   //Prepare detector response FFT
   std::vector<double> ser( fSinglePEWave.begin(), std::next(fSinglePEWave.begin(), size) );
-  std::vector<TComplex> serfft;
-  serfft.resize(size);
-  fft_service->DoFFT(ser, serfft);
+  spectra.ser.resize(size);
+  fft.DoFFT(ser, spectra.ser);
+
+  //Prepare L
+  if(!fUseParamFilter){
+    std::vector<double> hypo( fSignalHypothesis.begin(), std::next(fSignalHypothesis.begin(), size) );
+    spectra.hypo.resize(size);
+    fft.DoFFT(hypo, spectra.hypo);
+  }
+  return spectra;
+}
+
+
+opdet::OpDeconvolutionAlgWiener::Kernel opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_t wfsize, double baseline_stddev, double snr_scaling, size_t wfIndex, unsigned worker){
+  size_t size=WfSizeFFT(wfsize);
+
+  //Prepare Noise Spectral Power
+  double noise_power=wfsize*baseline_stddev*baseline_stddev;
+  if(fScaleHypoSignal){
+    noise_power/=pow(snr_scaling, 2);
+  }
+
+  //The kernel only depends on the FFT size and on the noise power: the
+  //noise power is binned in steps of KernelCacheStep in log scale and the
+  //kernel of the bin centre is used for all the waveforms in the bin.
+  //A parametrized filter does not depend on the noise at all.
+  long bin=0;
+  bool cache=true;
+  if(!fUseParamFilter){
+    cache=fKernelCacheStep>0 && std::isfinite(noise_power) && noise_power>0;
+    if(cache){
+      bin=std::lround(std::log(noise_power)/fKernelCacheStep);
+      noise_power=std::exp(bin*fKernelCacheStep);
+    }
+  }
+
+  //Kernels are shared with the other workers: clearing the cache does not
+  //free a kernel still in use
+  std::lock_guard<std::mutex> lock(fKernelMutex);
+  auto key=std::make_pair(size, bin);
+  if(cache){
+    auto it=fKernelCache.find(key);
+    if(it!=fKernelCache.end()){
+      fNKernelsReused++;
+      return it->second;
+    }
+  }
+
+  auto kernel=std::make_shared<std::vector<TComplex>>();
+  BuildKernel(size, noise_power, wfIndex, worker, *kernel);
+  fNKernelsBuilt++;
+  if(cache){
+    if(fKernelCache.size()>=fKernelCacheMaxSize)
+      fKernelCache.clear();
+    fKernelCache[key]=kernel;
+  }
+  return kernel;
+}
+
+
+//Called with fKernelMutex held
+void opdet::OpDeconvolutionAlgWiener::BuildKernel(size_t size, double noise_power, size_t wfIndex, unsigned worker, std::vector<TComplex>& kernel){
+  //Initizalize kernel
+  TComplex kerinit(0,0,false);
+  kernel.assign(size/2+1, kerinit);
+
+  ResponseSpectra const& spectra=GetResponseSpectra(size, worker);
+  std::vector<TComplex> const& serfft=spectra.ser;
 
   if(fUseParamFilter){
     double freq_step=fSamplingFreq/size;
@@ -379,18 +517,7 @@ std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_
     //R=Detector resopnse FFT
     //N=Noise mean spectral power
     //L=True signal mean spectral power
-
-    //Prepare L
-    std::vector<double> hypo( fSignalHypothesis.begin(), std::next(fSignalHypothesis.begin(), size) );
-    std::vector<TComplex> hypofft;
-    hypofft.resize(size);
-    fft_service->DoFFT(hypo, hypofft);
-
-    //Prepare Noise Spectral Power
-    double noise_power=wfsize*baseline_stddev*baseline_stddev;
-    if(fScaleHypoSignal){
-      noise_power/=pow(snr_scaling, 2);
-    }
+    std::vector<TComplex> const& hypofft=spectra.hypo;
 
     for(size_t k=0; k<size/2; k++){
       double den = pow(TComplex::Abs(serfft[k]), 2) + noise_power / pow(TComplex::Abs(hypofft[k]), 2) ;
@@ -401,14 +528,12 @@ std::vector<TComplex> opdet::OpDeconvolutionAlgWiener::DeconvolutionKernel(size_
 
 
   if(fDebug){
-    std::string name="h_wienerfilter_"+std::to_string(NDecoWf);
+    std::string name="h_wienerfilter_"+std::to_string(wfIndex);
     TH1F * hs_wiener = tfs->make< TH1F >
       (name.c_str(),"Wiener Filter;Frequency Bin;Magnitude",size/2, 0, size/2);
     for(size_t k=0; k<size/2; k++)
       hs_wiener->SetBinContent(k, TComplex::Abs( kernel[k]*serfft[k] ) );
   }
-
-  return kernel;
 }
 
 DEFINE_ART_CLASS_TOOL(opdet::OpDeconvolutionAlgWiener)
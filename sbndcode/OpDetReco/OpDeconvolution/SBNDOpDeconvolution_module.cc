@@ -24,6 +24,7 @@
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
 #include "sbndcode/OpDetReco/OpDeconvolution/Alg/OpDeconvolutionAlg.hh"
+#include "sbndcode/Utilities/FFTPlanCacheSBND.h"
 
 namespace opdet {
   class SBNDOpDeconvolution;
@@ -44,6 +45,7 @@ public:
 
   // Required functions.
   void produce(art::Event& e) override;
+  void endJob() override;
 
 
 private:
@@ -51,6 +53,7 @@ private:
   // Declare member data here.
   std::string fInputLabel;
   std::vector<std::string> fPDTypes;
+  std::vector<bool> fSelectedPDType; //indexed by sbndPDMapAlg::PDType
   //OpDecoAlg tool
   std::unique_ptr<opdet::OpDeconvolutionAlg> fOpDecoAlgPtr;
   //PDS map
@@ -66,6 +69,10 @@ opdet::SBNDOpDeconvolution::SBNDOpDeconvolution(fhicl::ParameterSet const& p)
   // Call appropriate consumes<>() for any products to be retrieved by this module.
   fInputLabel = p.get< std::string >("InputLabel");
   fPDTypes = p.get< std::vector<std::string> >("PDTypes");
+  fSelectedPDType.assign(opdet::sbndPDMapAlg::kNPDTypes + 1, false);
+  for(auto const& type : fPDTypes){
+    fSelectedPDType[static_cast<size_t>(opdet::sbndPDMapAlg::pdTypeFromName(type))] = true;
+  }
   fOpDecoAlgPtr = art::make_tool<opdet::OpDeconvolutionAlg>( p.get< fhicl::ParameterSet >("OpDecoAlg") );
 
   produces< std::vector< raw::OpDetWaveform > >();
@@ -85,7 +92,7 @@ void opdet::SBNDOpDeconvolution::produce(art::Event& e)
   RawWfVector.reserve(wfHandle->size());
 
   for(auto const& wf : *wfHandle){
-    if(std::find(fPDTypes.begin(), fPDTypes.end(), pdsmap.pdType(wf.ChannelNumber()) ) != fPDTypes.end() ){
+    if(fSelectedPDType[static_cast<size_t>(pdsmap.pdTypeOf(wf.ChannelNumber()))]){
       RawWfVector.push_back(wf);
     }
   }
@@ -98,4 +105,9 @@ void opdet::SBNDOpDeconvolution::produce(art::Event& e)
 
 }
 
+void opdet::SBNDOpDeconvolution::endJob()
+{
+  mf::LogInfo("SBNDOpDeconvolution") << util::FFTPlanCacheSBND::Summary();
+}
+
 DEFINE_ART_MODULE(opdet::SBNDOpDeconvolution)
@@ -4,6 +4,7 @@
 #include "SimpleFlashAlgo.h"
 #include <set>
 #include <algorithm>
+#include <limits>
 
 namespace lightana{
     
@@ -124,16 +125,12 @@ namespace lightana{
     SimpleFlashAlgo::~SimpleFlashAlgo()
     {}
     
-    LiteOpFlashArray_t SimpleFlashAlgo::RecoFlash(const LiteOpHitArray_t ophits) {
+    LiteOpFlashArray_t SimpleFlashAlgo::RecoFlash(const LiteOpHitArray_t& ophits) {
         
         Reset();
         size_t max_ch = _opch_to_index_v.size() - 1;
         size_t NOpDet = _index_to_opch_v.size();
         
-        //static std::vector<double> pesum_v;
-        static std::vector<double> mult_v;  //< this is not strictly a multiplicity of PMTs, but multiplicity of hits
-        static std::vector<std::vector<double> > pespec_v;
-        static std::vector<std::vector<unsigned int> > hitidx_v;
         double min_time=1.1e20;
         double max_time=1.1e20;
         for(auto const& oph : ophits) {
@@ -147,17 +144,12 @@ namespace lightana{
         
         size_t nbins_pesum_v = (size_t)((max_time - min_time) / _time_res) + 1;
         if(_pesum_v.size() < nbins_pesum_v) _pesum_v.resize(nbins_pesum_v,0);
-        if(mult_v.size()   < nbins_pesum_v) mult_v.resize(nbins_pesum_v,0);
-        if(pespec_v.size() < nbins_pesum_v) pespec_v.resize(nbins_pesum_v,std::vector<double>(NOpDet));
-        if(hitidx_v.size() < nbins_pesum_v) hitidx_v.resize(nbins_pesum_v,std::vector<unsigned int>());
-        for(size_t i=0; i<_pesum_v.size(); ++i) {
-            _pesum_v[i] = 0;
-            mult_v[i]  = 0;
-            hitidx_v[i].clear();
-            for(auto& v : pespec_v[i]) v=0;
-        }
+        if(_pespec_v.size() < NOpDet) _pespec_v.resize(NOpDet,0);
+        // only the bins filled by the previous call are non-zero
+        for(auto const& bin : _bin_v) _pesum_v[bin] = 0;
         
-        // Fill _pesum_v
+        // Collect the hits to use with their time bin
+        _bin_hit_v.clear();
         for(size_t hitidx = 0; hitidx < ophits.size(); ++hitidx) {
             auto const& oph = ophits[hitidx];
             if(oph.channel > max_ch || _opch_to_index_v[oph.channel] < 0) {
@@ -169,36 +161,62 @@ namespace lightana{
                 continue;
             }
             size_t index = (size_t)((oph.peak_time - min_time) / _time_res);
-            // std::cout << "Ophit from ch " << oph.channel << " at time " << oph.peak_time << " with PE " << oph.pe << ", index " << index << std::endl;
-            _pesum_v[index] += oph.pe;
-            mult_v[index] += 1;
-            pespec_v[index][_opch_to_index_v[oph.channel]] += oph.pe;
-            hitidx_v[index].push_back(hitidx);
+            _bin_hit_v.emplace_back(index,hitidx);
+        }
+        // by bin, then in hit order as the sums are accumulated in that order
+        std::sort(_bin_hit_v.begin(), _bin_hit_v.end());
+        
+        // Fill _pesum_v and the list of bins with hits
+        _bin_v.clear();
+        _bin_start_v.clear();
+        for(size_t i=0; i<_bin_hit_v.size(); ++i) {
+            auto const& index = _bin_hit_v[i].first;
+            if(_bin_v.empty() || _bin_v.back() != index) {
+                _bin_v.push_back(index);
+                _bin_start_v.push_back(i);
+            }
+            _pesum_v[index] += ophits[_bin_hit_v[i].second].pe;
         }
+        _bin_start_v.push_back(_bin_hit_v.size());
         
-        // Order by pe (above threshold)
-        std::map<double,size_t> pesum_idx_map;
-        for(size_t idx=0; idx<nbins_pesum_v; ++idx) {
-            // std::cout <<  "    _pesum_v at " << idx << " is " << _pesum_v[idx] << ", _min_pe_coinc is " << _min_pe_coinc << std::endl;
+        // Order by pe (above threshold): ascending 1/pesum and, as for a map
+        // keyed on it, only the last bin for each value
+        _candidate_v.clear();
+        for(size_t b=0; b<_bin_v.size(); ++b) {
+            auto const& idx = _bin_v[b];
+            double mult = _bin_start_v[b+1] - _bin_start_v[b]; //< multiplicity of hits, not of PMTs
             if(_pesum_v[idx] < _min_pe_coinc   ) continue;
-            // std::cout <<  "    mult_v at " << idx << " is " << mult_v[idx] << ", _min_mult_coinc is " << _min_mult_coinc << std::endl;
-            if(mult_v[idx]  < _min_mult_coinc ) continue;
-            pesum_idx_map[1./(_pesum_v[idx])] = idx;
+            if(mult          < _min_mult_coinc ) continue;
+            _candidate_v.emplace_back(1./(_pesum_v[idx]),idx);
         }
+        if(0 >= _min_pe_coinc && 0 >= _min_mult_coinc) {
+            // empty bins are candidates too, all with the same 1/0 key
+            size_t b = _bin_v.size();
+            size_t idx = nbins_pesum_v;
+            while(idx > 0 && b > 0 && _bin_v[b-1] == idx-1) { --idx; --b; }
+            if(idx > 0) _candidate_v.emplace_back(std::numeric_limits<double>::infinity(),idx-1);
+        }
+        std::sort(_candidate_v.begin(), _candidate_v.end(),
+                  [](std::pair<double,size_t> const& a, std::pair<double,size_t> const& b)
+                  { return a.first < b.first || (a.first == b.first && a.second > b.second); });
+        _candidate_v.erase(std::unique(_candidate_v.begin(), _candidate_v.end(),
+                                       [](std::pair<double,size_t> const& a, std::pair<double,size_t> const& b)
+                                       { return a.first == b.first; }),
+                           _candidate_v.end());
         
         // Get candidate flash times
-        std::vector<std::pair<size_t,size_t> > flash_period_v;
-        std::vector<size_t> flash_time_v;
+        auto& flash_period_v = _flash_period_v;
+        auto& flash_time_v = _flash_time_v;
+        flash_period_v.clear();
+        flash_time_v.clear();
         size_t veto_ctr = (size_t)(_veto_time / _time_res);
         size_t default_integral_ctr = (size_t)(_integral_time / _time_res);
         size_t precount = (size_t)(_pre_sample / _time_res);
-        flash_period_v.reserve(pesum_idx_map.size());
-        flash_time_v.reserve(pesum_idx_map.size());
         
         double sum_baseline = 0;
         //for(auto const& v : _pe_baseline_v) sum_baseline += v;
 
-        for(auto const& pe_idx : pesum_idx_map) {
+        for(auto const& pe_idx : _candidate_v) {
                         
           //auto const& pe  = 1./(pe_idx.first);
             auto const& idx = pe_idx.second;
@@ -265,11 +283,27 @@ namespace lightana{
             auto const& time   = flash_time_v[flash_idx];
             
             std::vector<double> pe_v(max_ch+1,0);
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
+            std::vector<unsigned int> asshit_v;
+            auto bin_begin = std::lower_bound(_bin_v.begin(), _bin_v.end(), start);
+            auto bin_end   = std::lower_bound(bin_begin, _bin_v.end(), start+period);
+            for(auto bin_iter = bin_begin; bin_iter != bin_end; ++bin_iter) {
                 
-                for(size_t pmt_index=0; pmt_index<NOpDet; ++pmt_index)
-                    
-                    pe_v[_index_to_opch_v[pmt_index]] += pespec_v[index][pmt_index];
+                size_t b = bin_iter - _bin_v.begin();
+                for(size_t i=_bin_start_v[b]; i<_bin_start_v[b+1]; ++i) {
+                    auto const& hitidx = _bin_hit_v[i].second;
+                    auto const& oph = ophits[hitidx];
+                    size_t pmt_index = _opch_to_index_v[oph.channel];
+                    if(_pespec_v[pmt_index] == 0) _pespec_idx_v.push_back(pmt_index);
+                    _pespec_v[pmt_index] += oph.pe;
+                    asshit_v.push_back(hitidx);
+                }
+                
+                // add up per bin, as the pe spectrum of a bin is summed first
+                for(auto const& pmt_index : _pespec_idx_v) {
+                    pe_v[_index_to_opch_v[pmt_index]] += _pespec_v[pmt_index];
+                    _pespec_v[pmt_index] = 0;
+                }
+                _pespec_idx_v.clear();
                 
             }
             
@@ -283,12 +317,6 @@ namespace lightana{
                 
             }
             
-            std::vector<unsigned int> asshit_v;
-            for(size_t index=start; index<(start+period) && index<pespec_v.size(); ++index) {
-                for(auto const& idx : hitidx_v[index])
-                    asshit_v.push_back(idx);
-            }
-            
             if(_debug) {
                 std::cout << "Claiming a flash @ " << min_time + time * _time_res
                 << " : " << std::flush;
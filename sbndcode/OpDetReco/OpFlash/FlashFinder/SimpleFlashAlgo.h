@@ -18,7 +18,7 @@ namespace lightana
     
     virtual ~SimpleFlashAlgo();
 
-    LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t ophits);
+    LiteOpFlashArray_t RecoFlash(const LiteOpHitArray_t& ophits);
 
     bool Veto(double t) const;
 
@@ -42,6 +42,16 @@ namespace lightana
 
     std::map<double,double> _flash_veto_range_m;  // veto window start
 
+    // RecoFlash work arrays, owned by the instance and kept between events
+    std::vector<std::pair<size_t,unsigned int> > _bin_hit_v; // (time bin, ophit index) of used hits, by bin
+    std::vector<size_t> _bin_v;                              // time bins with at least one hit, in order
+    std::vector<size_t> _bin_start_v;                        // first _bin_hit_v entry of each _bin_v bin
+    std::vector<std::pair<double,size_t> > _candidate_v;     // (1/pesum, bin) of the flash candidates
+    std::vector<std::pair<size_t,size_t> > _flash_period_v;  // (start bin, length) of the flashes
+    std::vector<size_t> _flash_time_v;                       // peak bin of the flashes
+    std::vector<double> _pespec_v;                           // pe per opdet index in one bin
+    std::vector<size_t> _pespec_idx_v;                       // opdet indices filled in _pespec_v
+
     bool _debug;            // debug mode flag
 
     // list of opchannel to use
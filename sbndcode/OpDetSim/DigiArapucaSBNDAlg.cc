@@ -1,5 +1,9 @@
 #include "sbndcode/OpDetSim/DigiArapucaSBNDAlg.hh"
 
+#include "CLHEP/Random/JamesRandom.h"
+
+#include <chrono>
+
 //------------------------------------------------------------------------------
 //--- opdet::simarapucasbndAlg implementation
 //------------------------------------------------------------------------------
@@ -14,6 +18,7 @@ namespace opdet {
     , fXArapucaVISEff(fParams.XArapucaVISEff / fParams.larProp->ScintPreScale())
     , fADCSaturation(fParams.Baseline + fParams.Saturation * fParams.ADC * fParams.MeanAmplitude)
     , fEngine(fParams.engine)
+    , fNoise(fParams.engine)
   {
 
     if(fXArapucaVUVEff > 1.0001 || fXArapucaVISEff > 1.0001)
@@ -33,16 +38,17 @@ namespace opdet {
     //Note: TPB time now implemented at digitization module for both coated pmts and (x)arapucas
     //OpDetSim/digi_arapuca_sbnd.root updated in sbnd_data (now including the TPB times vector)
 
-    // TPB emission time histogram for visible (x)arapucas
+    // TPB emission time histogram for visible (x)arapucas, folded with the
+    // EJ280 decay into a single table
     std::vector<double>* timeTPB_p;
     file->GetObject("timeTPB", timeTPB_p);
-    fTimeTPB = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, timeTPB_p->data(), timeTPB_p->size());
+    fTimeXArapucaVIS = OpDetTimeSamplerSBND(timeTPB_p->data(), timeTPB_p->size(), fParams.DecayTXArapucaVIS);
+    fTimeDecayVIS = OpDetTimeSamplerSBND(nullptr, 0, fParams.DecayTXArapucaVIS);
 
     std::vector<double>* TimeXArapucaVUV_p;
     file->GetObject("TimeXArapucaVUV", TimeXArapucaVUV_p);
-    fTimeXArapucaVUV = std::make_unique<CLHEP::RandGeneral>
-      (*fEngine, TimeXArapucaVUV_p->data(), TimeXArapucaVUV_p->size());
+    fTimeXArapucaVUV = OpDetTimeSamplerSBND(TimeXArapucaVUV_p->data(), TimeXArapucaVUV_p->size());
+    if(fParams.BenchmarkTimeSampler) fTimeXArapucaVUVPdf = *TimeXArapucaVUV_p;
 
     size_t pulseSize = fParams.PulseLength * fSampling;
     fWaveformSP.resize(pulseSize);
@@ -69,44 +75,47 @@ namespace opdet {
     file->Close();
   } // end constructor
 
-  DigiArapucaSBNDAlg::~DigiArapucaSBNDAlg() {}
+  DigiArapucaSBNDAlg::~DigiArapucaSBNDAlg()
+  {
+    if(fParams.BenchmarkTimeSampler) BenchmarkTimeSampling();
+  }
 
 
   void DigiArapucaSBNDAlg::ConstructWaveform(
     int ch,
     sim::SimPhotons const& simphotons,
-    std::vector<short unsigned int>& waveform,
+    raw::OpDetWaveform& waveform,
     std::string pdtype,
     bool is_daphne,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
-    CreatePDWaveform(simphotons, start_time, waves, pdtype,is_daphne);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_samples, fParams.Baseline);
+    CreatePDWaveform(simphotons, start_time, fWave, pdtype,is_daphne);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiArapucaSBNDAlg::ConstructWaveformLite(
     int ch,
     sim::SimPhotonsLite const& litesimphotons,
-    std::vector<short unsigned int>& waveform,
+    raw::OpDetWaveform& waveform,
     std::string pdtype,
     bool is_daphne,
     double start_time,
     unsigned n_samples)
   {
-    std::vector<double> waves(n_samples, fParams.Baseline);
+    fWave.assign(n_samples, fParams.Baseline);
     std::map<int, int> const& photonMap = litesimphotons.DetectedPhotons;
-    CreatePDWaveformLite(photonMap, start_time, waves, pdtype,is_daphne);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    CreatePDWaveformLite(photonMap, start_time, fWave, pdtype,is_daphne);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveform(
     sim::SimPhotons const& simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype,
     bool is_daphne)
   {
@@ -114,7 +123,7 @@ namespace opdet {
     if(pdtype == "xarapuca_vuv") {
       for(size_t i = 0; i < simphotons.size(); i++) {
         if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fXArapucaVUVEff) {
-          double tphoton = (fTimeXArapucaVUV->fire()) + simphotons[i].Time - t_min;
+          double tphoton = fTimeXArapucaVUV.fire(fEngine) + simphotons[i].Time - t_min;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
@@ -130,7 +139,7 @@ namespace opdet {
     else if(pdtype == "xarapuca_vis") {
       for(size_t i = 0; i < simphotons.size(); i++) {
         if((CLHEP::RandFlat::shoot(fEngine, 1.0)) < fXArapucaVISEff) {
-          double tphoton = (CLHEP::RandExponential::shoot(fEngine, fParams.DecayTXArapucaVIS)) + simphotons[i].Time - t_min + fTimeTPB->fire();
+          double tphoton = fTimeXArapucaVIS.fire(fEngine) + simphotons[i].Time - t_min;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
           else nCT = 1;
@@ -149,45 +158,41 @@ namespace opdet {
     }
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiArapucaSBNDAlg::CreatePDWaveformLite(
     std::map<int, int> const& photonMap,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     std::string pdtype,
     bool is_daphne)
   {
     if(pdtype == "xarapuca_vuv"){
-      SinglePDWaveformCreatorLite(fXArapucaVUVEff, fTimeXArapucaVUV, wave, photonMap, t_min,is_daphne);
+      SinglePDWaveformCreatorLite(fXArapucaVUVEff, fTimeXArapucaVUV, wave, photonMap, t_min, is_daphne, 0);
     }
     else if(pdtype == "xarapuca_vis"){
-      // creating the waveforms for xarapuca_vis is different than the rest
-      // so there's an overload for that which lacks the timeHisto
-      SinglePDWaveformCreatorLite(fXArapucaVISEff, wave, photonMap, t_min,is_daphne);
+      // the photon times of xarapuca_vis only have the decay time of EJ280
+      SinglePDWaveformCreatorLite(fXArapucaVISEff, fTimeDecayVIS, wave, photonMap, t_min, is_daphne, 1);
     }
     else{
       throw cet::exception("DigiARAPUCASBNDAlg") << "Wrong pdtype: " << pdtype << std::endl;
     }
     if(fParams.BaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.DarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
   }
 
 
   void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
     double effT,
-    std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-    std::vector<double>& wave,
+    OpDetTimeSamplerSBND const& timeSampler,
+    std::vector<float>& wave,
     std::map<int, int> const& photonMap,
     double const& t_min,
-    bool is_daphne
+    bool is_daphne,
+    int benchType
     )
   {
-    // TODO: check that this new approach of not using the last
-    // (1-accepted_photons) doesn't introduce some bias
     double meanPhotons;
     size_t acceptedPhotons;
     double tphoton;
@@ -196,13 +201,22 @@ namespace opdet {
       // (1-accepted_photons) doesn't introduce some bias
       meanPhotons = photonMember.second*effT;
       acceptedPhotons = CLHEP::RandPoissonQ::shoot(fEngine, meanPhotons);
+      if(acceptedPhotons == 0) continue;
+      if(fParams.BenchmarkTimeSampler) fBenchBuckets.push_back({benchType, acceptedPhotons});
+
+      // the photons of a bucket are alike, so the ones giving cross-talk
+      // can be taken to be the first nCrossTalk
+      size_t nCrossTalk = 0;
+      if(fParams.CrossTalk > 0.0)
+        nCrossTalk = CLHEP::RandBinomial::shoot(fEngine, acceptedPhotons, fParams.CrossTalk);
+      if(fFlat.size() < acceptedPhotons) fFlat.resize(acceptedPhotons);
+      fEngine->flatArray(acceptedPhotons, fFlat.data());
+
       for(size_t i = 0; i < acceptedPhotons; i++) {
-        tphoton = timeHisto->fire();
+        tphoton = timeSampler.Sample(fFlat[i]);
         tphoton += photonMember.first - t_min;
         if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        int nCT=1;
-        if(fParams.CrossTalk > 0.0 &&
-           (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
+        int nCT = (i < nCrossTalk) ? 2 : 1;
           size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
           if(timeBin < wave.size()) {
 						if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
@@ -214,37 +228,42 @@ namespace opdet {
   }
 
 
-  void DigiArapucaSBNDAlg::SinglePDWaveformCreatorLite(
-    double effT,
-    std::vector<double>& wave,
-    std::map<int, int> const& photonMap,
-    double const& t_min,
-    bool is_daphne
-    )
+  void DigiArapucaSBNDAlg::BenchmarkTimeSampling() const
   {
-    double meanPhotons;
-    size_t acceptedPhotons;
-    double tphoton;
-    int nCT;
-    for (auto const& photonMember : photonMap) {
-      // TODO: check that this new approach of not using the last
-      // (1-accepted_photons) doesn't introduce some bias
-      meanPhotons = photonMember.second*effT;
-      acceptedPhotons = CLHEP::RandPoissonQ::shoot(fEngine, meanPhotons);
-      for(size_t i = 0; i < acceptedPhotons; i++) {
-        tphoton = (CLHEP::RandExponential::shoot(fEngine, fParams.DecayTXArapucaVIS));
-        tphoton += photonMember.first - t_min;
-        if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
-        if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
-        else nCT = 1;
-          size_t timeBin = (is_daphne) ? std::floor(tphoton * fSampling_Daphne) : std::floor(tphoton * fSampling);
-          if(timeBin < wave.size()) {
-						if (!is_daphne) {AddSPE(timeBin, wave, fWaveformSP, nCT);
-						}
-            else{ AddSPE(timeBin, wave, fWaveformSP_Daphne, nCT);}
-          }
+    // Draw again the photon times and cross-talk of the buckets of this
+    // event, once with the per photon CLHEP generators and once with the
+    // tables, from a private engine so that the waveforms are not affected
+    if(fBenchBuckets.empty()) return;
+    CLHEP::HepJamesRandom engine;
+    CLHEP::RandGeneral timeVUV(engine, fTimeXArapucaVUVPdf.data(), fTimeXArapucaVUVPdf.size());
+    std::vector<double> flat;
+    size_t nPhotons = 0;
+    double sum = 0.;
+
+    auto start = std::chrono::steady_clock::now();
+    for(auto const& bucket : fBenchBuckets) {
+      for(size_t i = 0; i < bucket.n; i++) {
+        sum += (bucket.type == 0) ? timeVUV.fire() : CLHEP::RandExponential::shoot(&engine, fParams.DecayTXArapucaVIS);
+        if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(&engine, 1.0)) < fParams.CrossTalk) sum += 1.;
       }
+      nPhotons += bucket.n;
     }
+    auto middle = std::chrono::steady_clock::now();
+    for(auto const& bucket : fBenchBuckets) {
+      OpDetTimeSamplerSBND const& sampler = (bucket.type == 0) ? fTimeXArapucaVUV : fTimeDecayVIS;
+      if(fParams.CrossTalk > 0.0) sum += CLHEP::RandBinomial::shoot(&engine, bucket.n, fParams.CrossTalk);
+      if(flat.size() < bucket.n) flat.resize(bucket.n);
+      engine.flatArray(bucket.n, flat.data());
+      for(size_t i = 0; i < bucket.n; i++) sum += sampler.Sample(flat[i]);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    const double clhepTime = std::chrono::duration<double, std::milli>(middle - start).count();
+    const double tableTime = std::chrono::duration<double, std::milli>(end - middle).count();
+    mf::LogInfo("DigiArapucaSBNDAlg")
+      << "Photon time sampling of " << nPhotons << " photons in " << fBenchBuckets.size()
+      << " buckets: CLHEP " << clhepTime << " ms, tables " << tableTime << " ms"
+      << " (speedup " << (tableTime > 0. ? clhepTime/tableTime : 0.) << ", checksum " << sum << ")";
   }
 
   //Ideal single pulse waveform, same shape for both electronics (not realistic: different capacitances, ...) 
@@ -260,7 +279,7 @@ namespace opdet {
   
   void DigiArapucaSBNDAlg::AddSPE(
     const size_t time_bin,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     const std::vector<double>& fWaveformSP,
     const int nphotons) //adding single pulse //TODO: use only one function, use pulsize and fWaveformSP as arguments instead ~rodrigoa
   {
@@ -270,52 +289,39 @@ namespace opdet {
     auto max_it = std::next(wave.begin(), max);
     std::transform(min_it, max_it,
                    fWaveformSP.begin(), min_it,
-                   [nphotons](double w, double ws) -> double {
+                   [nphotons](float w, double ws) -> float {
                      return w + ws*nphotons  ; });
   }
 
-  void DigiArapucaSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiArapucaSBNDAlg::Digitize(std::vector<float> const& wave, raw::OpDetWaveform& waveform) const
   {
-    std::replace_if(wave.begin(), wave.end(),
-                    [&](auto w){return w > fADCSaturation;}, fADCSaturation);
+    // saturation and conversion to ADC counts in a single pass; the
+    // conversion truncates, as the one of the double waveform did
+    const float sat = std::min(fADCSaturation, (double) std::numeric_limits<raw::ADC_Count_t>::max());
+    waveform.resize(wave.size());
+    raw::ADC_Count_t* adc = waveform.data();
+    for(size_t i = 0; i < wave.size(); i++)
+      adc[i] = static_cast<raw::ADC_Count_t>(std::max(std::min(wave[i], sat), 0.f));
   }
 
 
-  void DigiArapucaSBNDAlg::AddLineNoise(std::vector< double >& wave)
+  void DigiArapucaSBNDAlg::AddLineNoise(std::vector<float>& wave)
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.BaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + CLHEP::RandGaussQ::shoot(fEngine, 0, fParams.BaselineRMS) ; });
+    fNoise.AddLineNoise(wave, fParams.BaselineRMS);
   }
 
 
-  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<double>& wave)
+  void DigiArapucaSBNDAlg::AddDarkNoise(std::vector<float>& wave)
   {
     int nCT;
     // Multiply by 10^9 since fDarkNoiseRate is in Hz (conversion from s to ns)
     double mean = 1000000000.0 / fParams.DarkNoiseRate;
-    double darkNoiseTime = CLHEP::RandExponential::shoot(fEngine, mean);
-    while(darkNoiseTime < wave.size()) {
+    for(double darkNoiseTime : fNoise.DarkCountTimes(wave.size(), wave.size() / mean)) {
       size_t timeBin = std::round(darkNoiseTime);
       if(fParams.CrossTalk > 0.0 && (CLHEP::RandFlat::shoot(fEngine, 1.0)) < fParams.CrossTalk) nCT = 2;
       else nCT = 1;
       if(timeBin < wave.size()) AddSPE(timeBin, wave, fWaveformSP, nCT);
-      // Find next time to add dark noise
-      darkNoiseTime += CLHEP::RandExponential::shoot(fEngine, mean);
-    }//while
+    }
   }
 
 
@@ -361,6 +367,7 @@ namespace opdet {
     fBaseConfig.DecayTXArapucaVIS = config.decayTXArapucaVIS();
     fBaseConfig.ArapucaDataFile   = config.arapucaDataFile();
     fBaseConfig.SinglePEmodel     = config.singlePEmodel();
+    fBaseConfig.BenchmarkTimeSampler = config.benchmarkTimeSampler();
     fBaseConfig.frequency_Daphne  = config.DaphneFrequency();
   }
 
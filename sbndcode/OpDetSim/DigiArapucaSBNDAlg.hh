@@ -17,11 +17,13 @@
 #include "CLHEP/Random/RandGeneral.h"
 #include "CLHEP/Random/RandPoissonQ.h"
 #include "CLHEP/Random/RandExponential.h"
+#include "CLHEP/Random/RandBinomial.h"
 
 #include <algorithm>
 #include <memory>
 #include <vector>
 #include <cmath>
+#include <limits>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -34,6 +36,9 @@
 #include "lardataobj/Simulation/SimPhotons.h"
 #include "lardata/DetectorInfoServices/LArPropertiesService.h"
 
+#include "sbndcode/OpDetSim/opDetNoiseSBND.hh"
+#include "sbndcode/OpDetSim/opDetTimeSamplerSBND.hh"
+
 #include "TFile.h"
 
 namespace opdet {
@@ -59,6 +64,7 @@ namespace opdet {
       double DecayTXArapucaVIS;// Decay time of EJ280 in ns
       std::string ArapucaDataFile; //File containing timing structure for arapucas
       bool SinglePEmodel; //Model for single pe response, false for ideal, true for test bench meas
+      bool BenchmarkTimeSampler; //Time the photon time sampling against the CLHEP generators
 
       detinfo::LArProperties const* larProp = nullptr; ///< LarProperties service provider.
       double frequency; ///< Optical-clock frequency
@@ -79,14 +85,14 @@ namespace opdet {
 
     void ConstructWaveform(int ch,
                            sim::SimPhotons const& simphotons,
-                           std::vector<short unsigned int>& waveform,
+                           raw::OpDetWaveform& waveform,
                            std::string pdtype,
                            bool is_daphne,
                            double start_time,
                            unsigned n_samples);
     void ConstructWaveformLite(int ch,
                                sim::SimPhotonsLite const& litesimphotons,
-                               std::vector<short unsigned int>& waveform,
+                               raw::OpDetWaveform& waveform,
                                std::string pdtype,
                                bool is_daphne,
                                double start_time,
@@ -104,42 +110,51 @@ namespace opdet {
     const double fADCSaturation;
 
     CLHEP::HepRandomEngine* fEngine; //!< Reference to art-managed random-number engine	
+    OpDetNoiseSBND fNoise; // line noise and dark counts, drawn from fEngine
+
+    OpDetTimeSamplerSBND fTimeXArapucaVUV; // photon time distribution inside the XArapuca VUV box (considering the optical window)
+    OpDetTimeSamplerSBND fTimeXArapucaVIS; // EJ280 decay and TPB emission time for visible (x)arapucas
+    OpDetTimeSamplerSBND fTimeDecayVIS;    // EJ280 decay only
 
-    std::unique_ptr<CLHEP::RandGeneral> fTimeXArapucaVUV;// histogram for getting the photon time distribution inside the XArapuca VUV box (considering the optical window)
-    std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for visible (x)arapucas
+    // benchmark of the photon time sampling against the CLHEP generators
+    struct PhotonBucket {
+      int type;      // 0: VUV, 1: VIS decay only
+      size_t n;      // accepted photons
+    };
+    std::vector<PhotonBucket> fBenchBuckets;
+    std::vector<double> fTimeXArapucaVUVPdf; // for the CLHEP side of the benchmark
+    std::vector<double> fFlat; // flat numbers for the photon times of a bucket
 
     std::vector<double> fWaveformSP; //single photon pulse vector
     std::vector<double> fWaveformSP_Daphne; //single photon pulse vector
+    std::vector<float> fWave; // analogue waveform of the channel being made, reused for all the channels
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
 
     void CreatePDWaveform(sim::SimPhotons const& SimPhotons,
                           double t_min,
-                          std::vector<double>& wave,
+                          std::vector<float>& wave,
                           std::string pdtype,
                           bool is_daphne);
     void CreatePDWaveformLite(std::map<int, int> const& photonMap,
                               double t_min,
-                              std::vector<double>& wave,
+                              std::vector<float>& wave,
                               std::string pdtype,
                               bool is_daphne);
     void SinglePDWaveformCreatorLite(double effT,
-                                     std::unique_ptr<CLHEP::RandGeneral>& timeHisto,
-                                     std::vector<double>& wave,
+                                     OpDetTimeSamplerSBND const& timeSampler,
+                                     std::vector<float>& wave,
                                      std::map<int, int> const& photonMap,
                                      double const& t_min,
-                                     bool is_daphne);
-    void SinglePDWaveformCreatorLite(double effT,
-                                     std::vector<double>& wave,
-                                     std::map<int, int> const& photonMap,
-                                     double const& t_min,
-                                     bool is_daphne);
-    void AddSPE(size_t time_bin, std::vector<double>& wave, const std::vector<double>& fWaveformSP, int nphotons); // add single pulse to auxiliary waveform
+                                     bool is_daphne,
+                                     int benchType);
+    void BenchmarkTimeSampling() const;
+    void AddSPE(size_t time_bin, std::vector<float>& wave, const std::vector<double>& fWaveformSP, int nphotons); // add single pulse to auxiliary waveform
     void Pulse1PE(std::vector<double>& wave,const double sampling);
-    void AddLineNoise(std::vector<double>& wave);
-    void AddDarkNoise(std::vector<double>& wave);
+    void AddLineNoise(std::vector<float>& wave);
+    void AddDarkNoise(std::vector<float>& wave);
     double FindMinimumTime(sim::SimPhotons const& simphotons);
     double FindMinimumTimeLite(std::map< int, int > const& photonMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects
+    void Digitize(std::vector<float> const& wave, raw::OpDetWaveform& waveform) const; // saturation and ADC conversion
   };//class DigiArapucaSBNDAlg
 
   class DigiArapucaSBNDAlgMaker {
@@ -239,6 +254,12 @@ namespace opdet {
         Comment("Model used for single PE response of PMT. =0 is ideal, =1 is from X-TDBoard data (with overshoot)")
       };
 
+      fhicl::Atom<bool> benchmarkTimeSampler {
+        Name("ArapucaBenchmarkTimeSampler"),
+        Comment("Time the photon time sampling of the SimPhotonsLite digitization against the CLHEP generators and report it for each event"),
+        false
+      };
+
       fhicl::Atom<double> DaphneFrequency {
         Name("DaphneFrequency"),
         Comment("Sampling Frequency of the XArapucas with Daphne readouts (SBND Light detection system has 2 readout frequencies). Apsaia readouts read the frec value from LArSoft.")
@@ -14,6 +14,7 @@ namespace opdet {
     , fQERefl(fParams.QERefl / fParams.larProp->ScintPreScale())
       //  , fSinglePEmodel(fParams.SinglePEmodel)
     , fEngine(fParams.engine)
+    , fNoise(fParams.engine)
   {
 
     mf::LogInfo("DigiPMTSBNDAlg") << "PMT corrected efficiencies = "
@@ -75,62 +76,62 @@ namespace opdet {
   void DigiPMTSBNDAlg::ConstructWaveform(
     int ch,
     sim::SimPhotons const& simphotons,
-    std::vector<short unsigned int>& waveform,
+    raw::OpDetWaveform& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveform(simphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveform(simphotons, start_time, fWave, ch, pdtype);
+    Digitize(fWave, waveform);
   }
 
   void DigiPMTSBNDAlg::ConstructWaveformCoatedPMT(
     int ch,
-    std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+    raw::OpDetWaveform& waveform,
+    sim::SimPhotons const* directPhotons,
+    sim::SimPhotons const* reflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformCoatedPMT(ch, start_time, fWave, directPhotons, reflectedPhotons);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLite(
     int ch,
     sim::SimPhotonsLite const& litesimphotons,
-    std::vector<short unsigned int>& waveform,
+    raw::OpDetWaveform& waveform,
     std::string pdtype,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLite(litesimphotons, start_time, waves, ch, pdtype);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLite(litesimphotons, start_time, fWave, ch, pdtype);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::ConstructWaveformLiteCoatedPMT(
     int ch,
-    std::vector<short unsigned int>& waveform,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+    raw::OpDetWaveform& waveform,
+    sim::SimPhotonsLite const* directPhotons,
+    sim::SimPhotonsLite const* reflectedPhotons,
     double start_time,
     unsigned n_sample)
   {
-    std::vector<double> waves(n_sample, fParams.PMTBaseline);
-    CreatePDWaveformLiteCoatedPMT(ch, start_time, waves, DirectPhotonsMap, ReflectedPhotonsMap);
-    waveform = std::vector<short unsigned int> (waves.begin(), waves.end());
+    fWave.assign(n_sample, fParams.PMTBaseline);
+    CreatePDWaveformLiteCoatedPMT(ch, start_time, fWave, directPhotons, reflectedPhotons);
+    Digitize(fWave, waveform);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveform(
     sim::SimPhotons const& simphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
@@ -151,45 +152,42 @@ namespace opdet {
 
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
+    if(fParams.SPEHistogramMode) ConvolveSPE(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    sim::SimPhotons const* directPhotons,
+    sim::SimPhotons const* reflectedPhotons)
   {
 
     double ttsTime = 0;
     double tphoton;
     size_t timeBin;
     double ttpb=0;
-    sim::SimPhotons auxphotons;
 
     //direct light
-    if(auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is direct light
+    const size_t nDirect = directPhotons ? directPhotons->size() : 0;
+    for(size_t j = 0; j < nDirect; j++) {
       if(CLHEP::RandFlat::shoot(fEngine, 1.0) < fQEDirect) {
         if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
         ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
+        tphoton = ttsTime + (*directPhotons)[j].Time - t_min + ttpb + fParams.CableTime;
         if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
         timeBin = std::floor(tphoton*fSampling);
         if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
       }
     }
     // reflected light
-    if(auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) )
-    {auxphotons = it->second;}
-    for(size_t j = 0; j < auxphotons.size(); j++) { //auxphotons is now reflected light
+    const size_t nReflected = reflectedPhotons ? reflectedPhotons->size() : 0;
+    for(size_t j = 0; j < nReflected; j++) {
       if(CLHEP::RandFlat::shoot(fEngine, 1.0) < fQERefl) {
         if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
         ttpb = fTimeTPB->fire(); //for including TPB emission time
-        tphoton = ttsTime + auxphotons[j].Time - t_min + ttpb + fParams.CableTime;
+        tphoton = ttsTime + (*reflectedPhotons)[j].Time - t_min + ttpb + fParams.CableTime;
         if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
         timeBin = std::floor(tphoton*fSampling);
         if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
@@ -199,14 +197,14 @@ namespace opdet {
     //Adding noise and saturation
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
+    if(fParams.SPEHistogramMode) ConvolveSPE(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformLite(
     sim::SimPhotonsLite const& litesimphotons,
     double t_min,
-    std::vector<double>& wave,
+    std::vector<float>& wave,
     int ch,
     std::string pdtype)
   {
@@ -235,16 +233,16 @@ namespace opdet {
 
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
+    if(fParams.SPEHistogramMode) ConvolveSPE(wave);
   }
 
 
   void DigiPMTSBNDAlg::CreatePDWaveformLiteCoatedPMT(
     int ch,
     double t_min,
-    std::vector<double>& wave,
-    std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-    std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap)
+    std::vector<float>& wave,
+    sim::SimPhotonsLite const* directPhotons,
+    sim::SimPhotonsLite const* reflectedPhotons)
   {
     double mean_photons;
     size_t accepted_photons;
@@ -253,16 +251,16 @@ namespace opdet {
     size_t timeBin;
     double ttpb;
     // direct light
-    if ( auto it{ DirectPhotonsMap.find(ch) }; it != std::end(DirectPhotonsMap) ){
-      for (auto& directPhotons : (it->second).DetectedPhotons) {
+    if ( directPhotons ){
+      for (auto& photons : directPhotons->DetectedPhotons) {
         // TODO: check that this new approach of not using the last
         // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = directPhotons.second*fQEDirect;
+        mean_photons = photons.second*fQEDirect;
         accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, mean_photons);
         for(size_t i = 0; i < accepted_photons; i++) {
           if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
           ttpb = fTimeTPB->fire(); //for including TPB emission time
-          tphoton = ttsTime + directPhotons.first - t_min + ttpb + fParams.CableTime;
+          tphoton = ttsTime + photons.first - t_min + ttpb + fParams.CableTime;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           timeBin = std::floor(tphoton*fSampling);
           if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
@@ -271,16 +269,16 @@ namespace opdet {
     }
 
     // reflected light
-    if ( auto it{ ReflectedPhotonsMap.find(ch) }; it != std::end(ReflectedPhotonsMap) ){
-      for (auto& reflectedPhotons : (it->second).DetectedPhotons) {
+    if ( reflectedPhotons ){
+      for (auto& photons : reflectedPhotons->DetectedPhotons) {
         // TODO: check that this new approach of not using the last
         // (1-accepted_photons) doesn't introduce some bias. ~icaza
-        mean_photons = reflectedPhotons.second*fQERefl;
+        mean_photons = photons.second*fQERefl;
         accepted_photons = CLHEP::RandPoissonQ::shoot(fEngine, mean_photons);
         for(size_t i = 0; i < accepted_photons; i++) {
           if(fParams.TTS > 0.0) ttsTime = Transittimespread(fParams.TTS); //implementing transit time spread
           ttpb = fTimeTPB->fire(); //for including TPB emission time
-          tphoton = ttsTime + reflectedPhotons.first - t_min + ttpb + fParams.CableTime;
+          tphoton = ttsTime + photons.first - t_min + ttpb + fParams.CableTime;
           if(tphoton < 0.) continue; // discard if it didn't made it to the acquisition
           timeBin = std::floor(tphoton*fSampling);
           if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
@@ -291,7 +289,7 @@ namespace opdet {
     //Adding noise and saturation
     if(fParams.PMTBaselineRMS > 0.0) AddLineNoise(wave);
     if(fParams.PMTDarkNoiseRate > 0.0) AddDarkNoise(wave);
-    CreateSaturation(wave);
+    if(fParams.SPEHistogramMode) ConvolveSPE(wave);
   }
 
 
@@ -320,8 +318,15 @@ namespace opdet {
   }
 
 
-  void DigiPMTSBNDAlg::AddSPE(size_t time_bin, std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddSPE(size_t time_bin, std::vector<float>& wave)
   {
+    if(fParams.SPEHistogramMode){
+      // only count the p.e. here, the pulses are added by ConvolveSPE()
+      if(fPECounts.size() < wave.size()) fPECounts.resize(wave.size(), 0);
+      fPECounts[time_bin]++;
+      return;
+    }
+
     size_t max = time_bin + pulsesize < wave.size() ? time_bin + pulsesize : wave.size();
     auto min_it = std::next(wave.begin(), time_bin);
     auto max_it = std::next(wave.begin(), max);
@@ -334,50 +339,61 @@ namespace opdet {
     else{
       std::transform(min_it, max_it,
                    fSinglePEWave.begin(), min_it,
-                   std::plus<double>( ));
+                   std::plus<>( ));
     }
   }
 
 
-  void DigiPMTSBNDAlg::CreateSaturation(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::ConvolveSPE(std::vector<float>& wave)
   {
-    std::replace_if(wave.begin(), wave.end(),
-                    [&](auto w){return w < saturation;}, saturation);
+    // One pulse per time bin with p.e., scaled by their number. With gain
+    // fluctuations the gain of n p.e. is drawn at once: the fluctuation of
+    // the first dynode is Poisson, so the sum of n single p.e. draws has the
+    // same distribution as a single draw for n p.e.
+    // The cost scales with the number of bins with p.e., which is bounded
+    // by the waveform length, rather than with the number of p.e.
+    const size_t nbins = std::min(fPECounts.size(), wave.size());
+    double const* spe = fSinglePEWave.data();
+    for(size_t time_bin = 0; time_bin < nbins; time_bin++){
+      const unsigned int npe = fPECounts[time_bin];
+      if(npe == 0) continue;
+      fPECounts[time_bin] = 0;
+
+      const double scale = fParams.MakeGainFluctuations ?
+        fPMTGainFluctuationsPtr->GainFluctuation(npe, fEngine) : npe;
+      const size_t n = std::min((size_t)pulsesize, wave.size() - time_bin);
+      float* w = wave.data() + time_bin;
+      for(size_t i = 0; i < n; i++) w[i] += scale*spe[i];
+    }
   }
 
 
-  void DigiPMTSBNDAlg::AddLineNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::Digitize(std::vector<float> const& wave, raw::OpDetWaveform& waveform) const
   {
-    // TODO: after running the profiler I can see that this is where
-    // most cycles are being used.  Potentially some improvement could
-    // be achieved with the below code but the array dynamic allocation
-    // is not helping. The function would need to have it passed.
-    // ~icaza
-    //
-    // double *array = new double[wave.size()]();
-    // CLHEP::RandGaussQ::shootArray(fEngine, wave.size(), array, 0, fParams.PMTBaselineRMS);
-    // for(size_t i = 0; i<wave.size(); i++) {
-    //   wave[i] += array[i];
-    // }
-    // delete array;
-    //
-    std::transform(wave.begin(), wave.end(), wave.begin(),
-                   [this](double w) -> double {
-                     return w + CLHEP::RandGaussQ::shoot(fEngine, 0, fParams.PMTBaselineRMS) ; });
+    // saturation (negative polarity) and conversion to ADC counts in a single
+    // pass; the conversion truncates, as the one of the double waveform did
+    const float sat = std::max(saturation, 0.);
+    const float maxADC = std::numeric_limits<raw::ADC_Count_t>::max();
+    waveform.resize(wave.size());
+    raw::ADC_Count_t* adc = waveform.data();
+    for(size_t i = 0; i < wave.size(); i++)
+      adc[i] = static_cast<raw::ADC_Count_t>(std::min(std::max(wave[i], sat), maxADC));
   }
 
 
-  void DigiPMTSBNDAlg::AddDarkNoise(std::vector<double>& wave)
+  void DigiPMTSBNDAlg::AddLineNoise(std::vector<float>& wave)
+  {
+    fNoise.AddLineNoise(wave, fParams.PMTBaselineRMS);
+  }
+
+
+  void DigiPMTSBNDAlg::AddDarkNoise(std::vector<float>& wave)
   {
-    size_t timeBin;
     // Multiply by 10^9 since fParams.DarkNoiseRate is in Hz (conversion from s to ns)
     double mean =  1000000000.0 / fParams.PMTDarkNoiseRate;
-    double darkNoiseTime = CLHEP::RandExponential::shoot(fEngine, mean);
-    while(darkNoiseTime < wave.size()) {
-      timeBin = std::round(darkNoiseTime);
+    for(double darkNoiseTime : fNoise.DarkCountTimes(wave.size(), wave.size() / mean)) {
+      size_t timeBin = std::round(darkNoiseTime);
       if(timeBin < wave.size()) {AddSPE(timeBin, wave);}
-      // Find next time to add dark noise
-      darkNoiseTime += CLHEP::RandExponential::shoot(fEngine, mean);
     }
   }
 
@@ -475,6 +491,7 @@ namespace opdet {
     fBaseConfig.PMTDataFile              = config.pmtDataFile();
     fBaseConfig.MakeGainFluctuations     = config.makeGainFluctuations();
     config.gainFluctuationsParams.get_if_present(fBaseConfig.GainFluctuationsParams);
+    fBaseConfig.SPEHistogramMode         = config.speHistogramMode();
   }
 
   std::unique_ptr<DigiPMTSBNDAlg>
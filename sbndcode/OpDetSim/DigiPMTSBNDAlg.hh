@@ -25,6 +25,7 @@
 #include <memory>
 #include <vector>
 #include <cmath>
+#include <limits>
 #include <string>
 #include <map>
 #include <unordered_map>
@@ -39,6 +40,8 @@
 
 #include "sbndcode/OpDetSim/PMTAlg/PMTGainFluctuations.hh"
 
+#include "sbndcode/OpDetSim/opDetNoiseSBND.hh"
+
 #include "TFile.h"
 
 namespace opdet {
@@ -65,6 +68,7 @@ namespace opdet {
       bool SinglePEmodel; //Model for single pe response, false for ideal, true for test bench meas
       bool MakeGainFluctuations; //Fluctuate PMT gain
       fhicl::ParameterSet GainFluctuationsParams;
+      bool SPEHistogramMode; //Count p.e. per time bin, then add the single pe pulses bin by bin
 
       detinfo::LArProperties const* larProp = nullptr; //< LarProperties service provider.
       double frequency;       //wave sampling frequency (GHz)
@@ -79,32 +83,33 @@ namespace opdet {
     void ConstructWaveform(
       int ch,
       sim::SimPhotons const& simphotons,
-      std::vector<short unsigned int>& waveform,
+      raw::OpDetWaveform& waveform,
       std::string pdtype,
       double start_time,
       unsigned n_sample);
 
+    // direct and reflected light of the channel, nullptr if there is none
     void ConstructWaveformCoatedPMT(
       int ch,
-      std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap,
+      raw::OpDetWaveform& waveform,
+      sim::SimPhotons const* directPhotons,
+      sim::SimPhotons const* reflectedPhotons,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformLite(
       int ch,
       sim::SimPhotonsLite const& litesimphotons,
-      std::vector<short unsigned int>& waveform,
+      raw::OpDetWaveform& waveform,
       std::string pdtype,
       double start_time,
       unsigned n_sample);
 
     void ConstructWaveformLiteCoatedPMT(
       int ch,
-      std::vector<short unsigned int>& waveform,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap,
+      raw::OpDetWaveform& waveform,
+      sim::SimPhotonsLite const* directPhotons,
+      sim::SimPhotonsLite const* reflectedPhotons,
       double start_time,
       unsigned n_sample);
 
@@ -128,46 +133,50 @@ namespace opdet {
     double saturation;
 
     CLHEP::HepRandomEngine* fEngine; //!< Reference to art-managed random-number engine
+    OpDetNoiseSBND fNoise; // line noise and dark counts, drawn from fEngine
 
     //PMTFluctuationsAlg
     std::unique_ptr<opdet::PMTGainFluctuations> fPMTGainFluctuationsPtr;
 
-    void AddSPE(size_t time_bin, std::vector<double>& wave); // add single pulse to auxiliary waveform
+    void AddSPE(size_t time_bin, std::vector<float>& wave); // add single pulse to auxiliary waveform
+    void ConvolveSPE(std::vector<float>& wave); // add the pulses of the p.e. counted by AddSPE in histogram mode
     void Pulse1PE(std::vector<double>& wave);
     double Transittimespread(double fwhm);
 
     std::vector<double> fSinglePEWave; // single photon pulse vector
     int pulsesize; //size of 1PE waveform
+    std::vector<unsigned int> fPECounts; // p.e. per time bin in histogram mode
+    std::vector<float> fWave; // analogue waveform of the channel being made, reused for all the channels
     std::unique_ptr<CLHEP::RandGeneral> fTimeTPB; // histogram for getting the TPB emission time for coated PMTs
     std::unordered_map< raw::Channel_t, std::vector<double> > fFullWaveforms;
 
     void CreatePDWaveform(
       sim::SimPhotons const& SimPhotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotons>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotons>& ReflectedPhotonsMap);
+      std::vector<float>& wave,
+      sim::SimPhotons const* directPhotons,
+      sim::SimPhotons const* reflectedPhotons);
     void CreatePDWaveformLite(
       sim::SimPhotonsLite const& litesimphotons,
       double t_min,
-      std::vector<double>& wave,
+      std::vector<float>& wave,
       int ch,
       std::string pdtype);
     void CreatePDWaveformLiteCoatedPMT(
       int ch,
       double t_min,
-      std::vector<double>& wave,
-      std::unordered_map<int, sim::SimPhotonsLite>& DirectPhotonsMap,
-      std::unordered_map<int, sim::SimPhotonsLite>& ReflectedPhotonsMap);
-    void CreateSaturation(std::vector<double>& wave);//Including saturation effects
-    void AddLineNoise(std::vector<double>& wave); //add noise to baseline
-    void AddDarkNoise(std::vector<double>& wave); //add dark noise
+      std::vector<float>& wave,
+      sim::SimPhotonsLite const* directPhotons,
+      sim::SimPhotonsLite const* reflectedPhotons);
+    void Digitize(std::vector<float> const& wave, raw::OpDetWaveform& waveform) const; // saturation and ADC conversion
+    void AddLineNoise(std::vector<float>& wave); //add noise to baseline
+    void AddDarkNoise(std::vector<float>& wave); //add dark noise
     double FindMinimumTime(
       sim::SimPhotons const&,
       int ch,
@@ -272,6 +281,12 @@ namespace opdet {
         Comment("Parameters used for SinglePE response fluctuations")
       };
 
+      fhicl::Atom<bool> speHistogramMode {
+        Name("SPEHistogramMode"),
+        Comment("Count the p.e. in each time bin and add one pulse per bin, scaled by the number of p.e. (and gain fluctuation), instead of one pulse per p.e."),
+        false
+      };
+
     };    //struct Config
 
     DigiPMTSBNDAlgMaker(Config const& config); //Constructor
@@ -20,6 +20,7 @@
 
 #include "nurandom/RandomUtils/NuRandomService.h"
 #include "CLHEP/Random/JamesRandom.h"
+#include "CLHEP/Random/RandFlat.h"
 
 #include <memory>
 #include <vector>
@@ -31,6 +32,8 @@
 #include <sstream>
 #include <fstream>
 #include <thread>
+#include <chrono>
+#include <algorithm>
 #include <cstdlib>
 #include <stdexcept>
 
@@ -53,6 +56,7 @@
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
+#include "sbndcode/OpDetSim/opDetPhotonViewSBND.hh"
 
 namespace opdet {
 
@@ -114,6 +118,12 @@ namespace opdet {
         1
       };
 
+      fhicl::Atom<unsigned> ChannelChunkSize {
+        Name("ChannelChunkSize"),
+        Comment("Number of channels a thread takes at a time from the channels still to be processed. Defaults to 1."),
+        1
+      };
+
       fhicl::TableFragment<opdet::DigiPMTSBNDAlgMaker::Config> pmtAlgoConfig;
       fhicl::TableFragment<opdet::DigiArapucaSBNDAlgMaker::Config> araAlgoConfig;
       fhicl::TableFragment<opdet::opDetSBNDTriggerAlg::Config> trigAlgoConfig;
@@ -135,6 +145,7 @@ namespace opdet {
 
     // Required functions.
     void produce(art::Event & e) override;
+    void endJob() override;
 
     opdet::sbndPDMapAlg map; //map for photon detector types
     unsigned int nChannels = map.size();
@@ -150,12 +161,27 @@ namespace opdet {
     unsigned fNThreads;
     // digitizer workers
     std::vector<opdet::opDetDigitizerWorker> fWorkers;
-    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms;
+    std::vector<std::vector<raw::OpDetWaveform>> fTriggeredWaveforms; // per channel
     std::vector<std::thread> fWorkerThreads;
+    opdet::opDetDigitizerWorker::ChannelQueue fChannelQueue;
+
+    // per-event seed from which the workers seed each channel
+    CLHEP::HepJamesRandom *fSeedEngine;
+    long fEventSeed;
+
+    // per-event detector data for the workers finding the triggers
+    const detinfo::DetectorClocksData *fEventClockData = nullptr;
+    const detinfo::DetectorPropertiesData *fEventDetProp = nullptr;
+
+    // wall time the workers have been running for
+    double fWorkersTime;
 
     // product containers
     std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> fPhotonLiteHandles;
     std::vector<art::Handle<std::vector<sim::SimPhotons>>> fPhotonHandles;
+    // photons of each channel, indexed once per event for all the workers
+    opdet::OpDetPhotonViewSBND<sim::SimPhotonsLite> fPhotonLiteView;
+    opdet::OpDetPhotonViewSBND<sim::SimPhotons> fPhotonView;
 
     // sync stuff
     opdet::opDetDigitizerWorker::Semaphore fSemStart;
@@ -172,6 +198,9 @@ namespace opdet {
     , fUseSimPhotonsLite(config().UseSimPhotonsLite())
     , fPMTBaseline(config().pmtAlgoConfig().pmtbaseline())
     , fArapucaBaseline(config().araAlgoConfig().baseline())
+    , fChannelQueue(config().ChannelChunkSize())
+    , fEventSeed(0)
+    , fWorkersTime(0.)
     , fTriggerAlg(config().trigAlgoConfig())
   {
     opDetDigitizerWorker::Config wConfig( config().pmtAlgoConfig(), config().araAlgoConfig());
@@ -206,6 +235,10 @@ namespace opdet {
     mf::LogInfo("OpDetDigitizer") << "Digitizing on n threads: " << fNThreads << std::endl;
 
     wConfig.nThreads = fNThreads;
+    wConfig.FindTriggers = fApplyTriggers;
+    wConfig.PMTBaseline = fPMTBaseline;
+    wConfig.ArapucaBaseline = fArapucaBaseline;
+    fTriggerAlg.SetNWorkers(fNThreads);
 
     wConfig.UseSimPhotonsLite = config().UseSimPhotonsLite();
     wConfig.InputModuleName = config().InputModuleName();
@@ -220,22 +253,26 @@ namespace opdet {
 
     fFinished = false;
 
+    // Set random number gen seed from the NuRandomService; the workers
+    // reseed their own engines for each channel from it
+    art::ServiceHandle<rndm::NuRandomService> seedSvc;
+    fSeedEngine = new CLHEP::HepJamesRandom;
+    seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(fSeedEngine), "opDetDigitizerSBND");
+
+    fTriggeredWaveforms.resize(nChannels);
     fWorkers.reserve(fNThreads);
-    fTriggeredWaveforms.reserve(fNThreads);
     for (unsigned i = 0; i < fNThreads; i++) {
-      // Set random number gen seed from the NuRandomService
-      art::ServiceHandle<rndm::NuRandomService> seedSvc;
       CLHEP::HepJamesRandom *engine = new CLHEP::HepJamesRandom;
-      seedSvc->registerEngine(rndm::NuRandomService::CLHEPengineSeeder(engine), "opDetDigitizerSBND" + std::to_string(i));
-
-      fTriggeredWaveforms.emplace_back();
 
       // setup worker
       fWorkers.emplace_back(i, wConfig, engine, fTriggerAlg);
-      fWorkers[i].SetPhotonLiteHandles(&fPhotonLiteHandles);
-      fWorkers[i].SetPhotonHandles(&fPhotonHandles);
+      fWorkers[i].SetPhotonLiteView(&fPhotonLiteView);
+      fWorkers[i].SetPhotonView(&fPhotonView);
       fWorkers[i].SetWaveformHandle(&fWaveforms);
-      fWorkers[i].SetTriggeredWaveformHandle(&fTriggeredWaveforms[i]);
+      fWorkers[i].SetTriggeredWaveformHandle(&fTriggeredWaveforms);
+      fWorkers[i].SetChannelQueue(&fChannelQueue);
+      fWorkers[i].SetEventSeedHandle(&fEventSeed);
+      fWorkers[i].SetDetectorDataHandles(&fEventClockData, &fEventDetProp);
 
       // start worker thread
       fWorkerThreads.emplace_back(opdet::opDetDigitizerWorkerThread,
@@ -260,6 +297,17 @@ namespace opdet {
     // join the threads
     for (std::thread &thread : fWorkerThreads) thread.join();
 
+    delete fSeedEngine;
+  }
+
+  void opDetDigitizerSBND::endJob()
+  {
+    mf::LogInfo log("OpDetDigitizer");
+    log << "Digitizer threads busy/idle time over " << fWorkersTime << " s of work:";
+    for (const opdet::opDetDigitizerWorker &worker : fWorkers) {
+      log << "\n  thread " << (&worker - fWorkers.data()) << ": busy " << worker.BusyTime()
+          << " s, idle " << std::max(0., fWorkersTime - worker.BusyTime()) << " s";
+    }
   }
 
   void opDetDigitizerSBND::produce(art::Event & e)
@@ -280,47 +328,48 @@ namespace opdet {
       fPhotonLiteHandles = e.getMany<std::vector<sim::SimPhotonsLite>>();
       if (fPhotonLiteHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotonsLite not found -> No Optical Detector Simulation!\n";
+      fPhotonLiteView.Fill(fPhotonLiteHandles, nChannels);
     }
     else {
       fPhotonHandles.clear();
       //Get *ALL* SimPhotonsCollection from Event
-      fPhotonLiteHandles = e.getMany<std::vector<sim::SimPhotonsLite>>();
+      fPhotonHandles = e.getMany<std::vector<sim::SimPhotons>>();
       if (fPhotonHandles.size() == 0)
         mf::LogError("OpDetDigitizer") << "sim::SimPhotons not found -> No Optical Detector Simulation!\n";
+      fPhotonView.Fill(fPhotonHandles, nChannels);
     }
+    fEventSeed = CLHEP::RandFlat::shootInt(fSeedEngine, 900000000L);
+    fEventClockData = &clockData;
+    fEventDetProp = &detProp;
+
     // Start the workers!
-    // Run the digitizer over the full readout window
+    // Run the digitizer over the full readout window; when triggers are
+    // applied, the workers also find the trigger locations of each waveform
+    auto workersStart = std::chrono::steady_clock::now();
+    fChannelQueue.Reset(nChannels);
     opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
     opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+    fWorkersTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - workersStart).count();
 
     if (fApplyTriggers) {
-      // find the trigger locations for the waveforms
-      for (const raw::OpDetWaveform &waveform : fWaveforms) {
-        raw::Channel_t ch = waveform.ChannelNumber();
-        // skip light channels which don't correspond to readout channels
-        if (ch == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
-          continue;
-        }
-        raw::ADC_Count_t baseline = (map.isPDType(ch, "pmt_uncoated") || map.isPDType(ch, "pmt_coated")) ?
-                                    fPMTBaseline : fArapucaBaseline;
-        fTriggerAlg.FindTriggerLocations(clockData, detProp, waveform, baseline);
-      }
-
       // combine the triggers
       fTriggerAlg.MergeTriggerLocations();
       // Start the workers!
       // Apply the trigger locations
+      workersStart = std::chrono::steady_clock::now();
+      fChannelQueue.Reset(nChannels);
       opdet::StartopDetDigitizerWorkers(fNThreads, fSemStart);
       opdet::WaitopDetDigitizerWorkers(fNThreads, fSemFinish);
+      fWorkersTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - workersStart).count();
 
+      // move the waveforms into the pulseVecPtr in channel order
+      size_t nTriggered = 0;
+      for (const std::vector<raw::OpDetWaveform> &waveforms : fTriggeredWaveforms) nTriggered += waveforms.size();
+      pulseVecPtr->reserve(nTriggered);
       for (std::vector<raw::OpDetWaveform> &waveforms : fTriggeredWaveforms) {
-        // move these waveforms into the pulseVecPtr
-        pulseVecPtr->reserve(pulseVecPtr->size() + waveforms.size());
         std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*pulseVecPtr));
-      }
-      // clean up the vector
-      for (unsigned i = 0; i < fTriggeredWaveforms.size(); i++) {
-        fTriggeredWaveforms[i] = std::vector<raw::OpDetWaveform>();
+        // clean up the vector
+        waveforms = std::vector<raw::OpDetWaveform>();
       }
 
       // put the waveforms in the event
@@ -3,6 +3,10 @@
 #include "larcore/CoreUtils/ServiceUtil.h"
 #include "sbndcode/OpDetSim/opDetDigitizerWorker.hh"
 
+#include <chrono>
+#include <cstdint>
+#include <utility>
+
 opdet::opDetDigitizerWorker::Config::Config(const opdet::DigiPMTSBNDAlgMaker::Config &pmt_config,
                                             const opdet::DigiArapucaSBNDAlgMaker::Config &arapuca_config):
   makePMTDigi(pmt_config),
@@ -11,11 +15,20 @@ opdet::opDetDigitizerWorker::Config::Config(const opdet::DigiPMTSBNDAlgMaker::Co
 opdet::opDetDigitizerWorker::opDetDigitizerWorker(unsigned no,
                                                   const Config &config,
                                                   CLHEP::HepRandomEngine *Engine,
-                                                  const opDetSBNDTriggerAlg &trigger_alg):
+                                                  opDetSBNDTriggerAlg &trigger_alg):
   fConfig(config),
   fThreadNo(no),
   fEngine(Engine),
-  fTriggerAlg(trigger_alg)
+  fTriggerAlg(trigger_alg),
+  fPhotonLiteView(nullptr),
+  fPhotonView(nullptr),
+  fWaveforms(nullptr),
+  fTriggeredWaveforms(nullptr),
+  fChannelQueue(nullptr),
+  fEventSeed(nullptr),
+  fEventClockData(nullptr),
+  fEventDetProp(nullptr),
+  fBusyTime(0.)
 {}
 
 void opdet::opDetDigitizerWorkerThread(const opdet::opDetDigitizerWorker &worker,
@@ -32,6 +45,7 @@ void opdet::opDetDigitizerWorkerThread(const opdet::opDetDigitizerWorker &worker
 
     if (*finished) break;
 
+    auto const start = std::chrono::steady_clock::now();
     if (do_apply_trigger_locations) {
       worker.ApplyTriggerLocations(clockData);
       do_apply_trigger_locations = false;
@@ -40,6 +54,7 @@ void opdet::opDetDigitizerWorkerThread(const opdet::opDetDigitizerWorker &worker
       worker.Start(clockData);
       do_apply_trigger_locations = ApplyTriggerLocations;
     }
+    worker.AddBusyTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
 
     sem_finish.increment();
   }
@@ -75,16 +90,29 @@ void opdet::opDetDigitizerWorker::Semaphore::decrement(unsigned n)
   count -= n;
 }
 
-unsigned opdet::opDetDigitizerWorker::NChannelsToProcess(unsigned n) const
+void opdet::opDetDigitizerWorker::ChannelQueue::Reset(unsigned n_channels)
+{
+  fNChannels = n_channels;
+  fNext = 0;
+}
+
+bool opdet::opDetDigitizerWorker::ChannelQueue::Next(unsigned &first, unsigned &last)
 {
-  return (n + fConfig.nThreads - fThreadNo - 1) / fConfig.nThreads;
+  first = fNext.fetch_add(fChunkSize);
+  if (first >= fNChannels) return false;
+  last = std::min(first + fChunkSize, fNChannels);
+  return true;
 }
 
-unsigned opdet::opDetDigitizerWorker::StartChannelToProcess(unsigned n) const
+long opdet::opDetDigitizerWorker::ChannelSeed(long event_seed, unsigned ch)
 {
-  unsigned n_per_job = n / fConfig.nThreads;
-  unsigned leftover = std::min(fThreadNo, n % fConfig.nThreads);
-  return n_per_job * fThreadNo + leftover;
+  // splitmix64 of (event seed, channel), folded into the range accepted by
+  // HepJamesRandom::setSeed()
+  uint64_t z = (uint64_t) event_seed + (ch + 1) * 0x9E3779B97F4A7C15ULL;
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  return (long) (z % 900000000ULL);
 }
 
 void opdet::opDetDigitizerWorker::Start(detinfo::DetectorClocksData const& clockData) const
@@ -111,22 +139,39 @@ opdet::opDetDigitizerWorker::~opDetDigitizerWorker()
 
 void opdet::opDetDigitizerWorker::ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const
 {
-  unsigned start = StartChannelToProcess(fConfig.nChannels);
-  unsigned n = NChannelsToProcess(fConfig.nChannels);
-
-  fTriggeredWaveforms->clear();
-
   // apply the triggers and save the output
-  for (const raw::OpDetWaveform &waveform : *fWaveforms){
-    if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
-      continue;
+  unsigned first, last;
+  while (fChannelQueue->Next(first, last)) {
+    for (unsigned ch = first; ch < last; ch++) {
+      const raw::OpDetWaveform &waveform = fWaveforms->at(ch);
+      if (waveform.ChannelNumber() == std::numeric_limits<raw::Channel_t>::max() /* "NULL" value*/) {
+        continue;
+      }
+      fTriggeredWaveforms->at(ch) = fTriggerAlg.ApplyTriggerLocations(clockData, waveform);
     }
-    // only work on the prescribed channels
-    if (waveform.ChannelNumber() < start || waveform.ChannelNumber() >= start + n) continue;
+  }
+}
 
-    std::vector<raw::OpDetWaveform> waveforms = fTriggerAlg.ApplyTriggerLocations(clockData, waveform);
+void opdet::opDetDigitizerWorker::FindTriggerLocations(unsigned ch) const
+{
+  // each channel is made by one worker only, so the trigger algorithm can
+  // be filled from all the workers at the same time
+  if (!fConfig.FindTriggers) return;
+  raw::ADC_Count_t baseline = fConfig.pdsMap.isPMT(ch) ? fConfig.PMTBaseline : fConfig.ArapucaBaseline;
+  fTriggerAlg.FindTriggerLocations(**fEventClockData, **fEventDetProp, fWaveforms->at(ch), baseline, fThreadNo);
+}
 
-    std::move(waveforms.begin(), waveforms.end(), std::back_inserter(*fTriggeredWaveforms));
+namespace {
+  // The records of one channel as a single one: the record itself if there
+  // is only one, else their sum in scratch; nullptr if there are none
+  template <class T>
+  T const* MergedPhotons(typename opdet::OpDetPhotonViewSBND<T>::Records const& records, T& scratch)
+  {
+    if (records.empty()) return nullptr;
+    if (records.size() == 1) return &records[0];
+    scratch = records[0];
+    for (size_t i = 1; i < records.size(); i++) scratch += records[i];
+    return &scratch;
   }
 }
 
@@ -134,246 +179,114 @@ void opdet::opDetDigitizerWorker::MakeWaveforms(opdet::DigiPMTSBNDAlg *pmtDigiti
                                                 opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const
 {
   if(fConfig.UseSimPhotonsLite) {
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> &photon_handles = *fPhotonLiteHandles;
-
-    // TODO: Instead of looping and evaluating if/else through all the photon_handles
-    // we should get smaller containers with only the relevant handles for each case
-    // ~icaza
-    // std::vector<art::Handle<std::vector<sim::SimPhotonsLite>> const*> ptr_photon_handles(photon_handles.size());
-    // std::transform(photon_handles.begin(), photon_handles.end(), ptr_photon_handles.begin(),
-    //                [](auto& p) {return std::addressof(p);});
-
-    // to temporarily store channel and combine PMT (direct and converted) time profiles
-
-
-    //need to combine direct and reflected photons
-    std::unordered_map<std::string, std::unordered_map<int, sim::SimPhotonsLite> > AllPhotonsMap;
-    AllPhotonsMap["Direct"] = std::unordered_map<int, sim::SimPhotonsLite>();
-    AllPhotonsMap["Reflected"] = std::unordered_map<int, sim::SimPhotonsLite>();
-    for (const art::Handle<std::vector<sim::SimPhotonsLite>> &opdetHandle : photon_handles) {
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& litesimphotons : (*opdetHandle)){
-
-        if(Reflected){
-          auto it = AllPhotonsMap["Reflected"].find(litesimphotons.OpChannel);
-          if(it==AllPhotonsMap["Reflected"].end())
-            AllPhotonsMap["Reflected"][litesimphotons.OpChannel] = litesimphotons;
-          else
-            AllPhotonsMap["Reflected"][litesimphotons.OpChannel] += litesimphotons;
-        }
-
-        else{ //Direct
-          auto it = AllPhotonsMap["Direct"].find(litesimphotons.OpChannel);
-          if(it==AllPhotonsMap["Direct"].end())
-            AllPhotonsMap["Direct"][litesimphotons.OpChannel] = litesimphotons;
-          else
-            AllPhotonsMap["Direct"][litesimphotons.OpChannel] += litesimphotons;
-        }
-      }
-    }
+    const opdet::OpDetPhotonViewSBND<sim::SimPhotonsLite> &photon_view = *fPhotonLiteView;
+    sim::SimPhotonsLite directScratch, reflectedScratch;
 
     const double startTime = fConfig.EnableWindow[0] * 1000. /*ns for digitizer*/;
 
-    std::unordered_map<int, sim::SimPhotonsLite> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotonsLite> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
-
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (auto const& simphotons_cols : AllPhotonsMap){
-      // this now tells you if light collection is reflected
-      const bool Reflected = (simphotons_cols.first=="Reflected");
-      for (auto const& simphotons_map : simphotons_cols.second) {
-
-        auto const& litesimphotons = simphotons_map.second;
-
-        std::vector<short unsigned int> waveform;
-        waveform.reserve(fConfig.Nsamples);
-        const unsigned ch = litesimphotons.OpChannel;
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-
-
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, litesimphotons));
-
-          coatedpmts_todigitize.insert(ch);
+    unsigned first, last;
+    while (fChannelQueue->Next(first, last)) {
+      for (unsigned ch = first; ch < last; ch++) {
+        sim::SimPhotonsLite const* direct = MergedPhotons(photon_view.Direct(ch), directScratch);
+        sim::SimPhotonsLite const* reflected = MergedPhotons(photon_view.Reflected(ch), reflectedScratch);
+        const bool hasDirect = (direct != nullptr);
+        const bool hasReflected = (reflected != nullptr);
+        if (!hasDirect && !hasReflected) continue;
+
+        // including pre trigger window and transit time
+        raw::OpDetWaveform waveform(fConfig.EnableWindow[0],
+                                    (unsigned int)ch,
+                                    fConfig.Nsamples);
+        const opdet::sbndPDMapAlg::PDType pdtype = fConfig.pdsMap.pdTypeOf(ch);
+        std::string const& pdname = opdet::sbndPDMapAlg::pdTypeName(pdtype);
+
+        fEngine->setSeed(ChannelSeed(*fEventSeed, ch), 0);
+
+        //Constructing Waveforms for hybrid OpChannels (coated pmts)
+        if( pdtype == opdet::sbndPDMapAlg::PDType::kPMTCoated ){
+          pmtDigitizer->ConstructWaveformLiteCoatedPMT(ch, waveform, direct, reflected, startTime, fConfig.Nsamples);
         }
-        else if( (Reflected) && (pdtype == "pmt_uncoated") ) { //Uncoated PMT channels
+        else if( hasReflected && (pdtype == opdet::sbndPDMapAlg::PDType::kPMTUncoated) ) { //Uncoated PMT channels
           pmtDigitizer->ConstructWaveformLite(ch,
-                                              litesimphotons,
+                                              *reflected,
                                               waveform,
-                                              pdtype,
+                                              pdname,
                                               startTime,
                                               fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-      	}
+        }
         // getting only xarapuca channels with appropriate type of light
-        else if((pdtype == "xarapuca_vuv" && !Reflected) ||
-                (pdtype == "xarapuca_vis" && Reflected) ) {
-          const bool is_daphne= fConfig.pdsMap.isElectronics(ch,"daphne");
-          if(is_daphne){
-            arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
-                                                  waveform,
-                                                  pdtype,
-                                                  is_daphne,
-                                                  startTime,
-                                                  fConfig.Nsamples_Daphne);
-            // including pre trigger window and transit time
-            fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-            }
-            else{
-            arapucaDigitizer->ConstructWaveformLite(ch,
-                                                  litesimphotons,
+        else if((pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVUV && hasDirect) ||
+                (pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVIS && hasReflected) ) {
+          const bool is_daphne= fConfig.pdsMap.isDaphne(ch);
+          arapucaDigitizer->ConstructWaveformLite(ch,
+                                                  (pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVUV) ? *direct : *reflected,
                                                   waveform,
-                                                  pdtype,
+                                                  pdname,
                                                   is_daphne,
                                                   startTime,
-                                                  fConfig.Nsamples);
-            // including pre trigger window and transit time
-            fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-          }
+                                                  is_daphne ? fConfig.Nsamples_Daphne : fConfig.Nsamples);
         }
+        else continue;
+
+        fWaveforms->at(ch) = std::move(waveform);
+        FindTriggerLocations(ch);
       }
-    }  //end loop on simphoton lite collections
-
-    //Constructing Waveforms for hybrid OpChannels (coated pmts)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformLiteCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
     }
   }
   else { // for SimPhotons
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> &photon_handles = *fPhotonHandles;
-
-    //need to combine direct and reflected photons
-    std::unordered_map<std::string, std::unordered_map<int, sim::SimPhotons> > AllPhotonsMap;
-    AllPhotonsMap["Direct"] = std::unordered_map<int, sim::SimPhotons>();
-    AllPhotonsMap["Reflected"] = std::unordered_map<int, sim::SimPhotons>();
-    for (const art::Handle<std::vector<sim::SimPhotons>> &opdetHandle : photon_handles) {
-      const bool Reflected = (opdetHandle.provenance()->productInstanceName() == "Reflected");
-      for (auto const& simphotons : (*opdetHandle)){
-
-        if(Reflected){
-          auto it = AllPhotonsMap["Reflected"].find(simphotons.OpChannel());
-          if(it==AllPhotonsMap["Reflected"].end())
-            AllPhotonsMap["Reflected"][simphotons.OpChannel()] = simphotons;
-          else
-            AllPhotonsMap["Reflected"][simphotons.OpChannel()] += simphotons;
-        }
-
-        else{ //Direct
-          auto it = AllPhotonsMap["Direct"].find(simphotons.OpChannel());
-          if(it==AllPhotonsMap["Direct"].end())
-            AllPhotonsMap["Direct"][simphotons.OpChannel()] = simphotons;
-          else
-            AllPhotonsMap["Direct"][simphotons.OpChannel()] += simphotons;
-        }
-      }
-    }
-
-
-    // to temporarily store channel and direct light distribution
-    std::unordered_map<int, sim::SimPhotons> DirectPhotonsMap;
-    std::unordered_map<int, sim::SimPhotons> ReflectedPhotonsMap;
-    std::unordered_set<short unsigned int> coatedpmts_todigitize;
+    const opdet::OpDetPhotonViewSBND<sim::SimPhotons> &photon_view = *fPhotonView;
+    sim::SimPhotons directScratch, reflectedScratch;
 
     const double startTime = fConfig.EnableWindow[0] * 1000. /*ns for digitizer*/;
 
-    const unsigned start = StartChannelToProcess(fConfig.nChannels);
-    const unsigned n = NChannelsToProcess(fConfig.nChannels);
-    for (auto const& simphotons_cols : AllPhotonsMap){
-      // this now tells you if light collection is reflected
-      const bool Reflected = (simphotons_cols.first=="Reflected");
-      for (auto const& simphotons_map : simphotons_cols.second) {
-
-        auto const& simphotons = simphotons_map.second;
-
-        std::vector<short unsigned int> waveform;
-        const unsigned ch = simphotons.OpChannel();
-        const std::string pdtype = fConfig.pdsMap.pdType(ch);
-        const bool is_daphne = fConfig.pdsMap.isElectronics(ch,"daphne");
-        // only work on the prescribed channels
-        if (ch < start || ch >= start + n) continue;
-        //coated PMTs
-        if( pdtype == "pmt_coated" ){
-          if(Reflected)
-            ReflectedPhotonsMap.insert(std::make_pair(ch, simphotons));
-          else
-            DirectPhotonsMap.insert(std::make_pair(ch, simphotons));
-
-          coatedpmts_todigitize.insert(ch);
+    unsigned first, last;
+    while (fChannelQueue->Next(first, last)) {
+      for (unsigned ch = first; ch < last; ch++) {
+        sim::SimPhotons const* direct = MergedPhotons(photon_view.Direct(ch), directScratch);
+        sim::SimPhotons const* reflected = MergedPhotons(photon_view.Reflected(ch), reflectedScratch);
+        const bool hasDirect = (direct != nullptr);
+        const bool hasReflected = (reflected != nullptr);
+        if (!hasDirect && !hasReflected) continue;
+
+        // including pre trigger window and transit time
+        raw::OpDetWaveform waveform(fConfig.EnableWindow[0],
+                                    (unsigned int)ch,
+                                    fConfig.Nsamples);
+        const opdet::sbndPDMapAlg::PDType pdtype = fConfig.pdsMap.pdTypeOf(ch);
+        std::string const& pdname = opdet::sbndPDMapAlg::pdTypeName(pdtype);
+
+        fEngine->setSeed(ChannelSeed(*fEventSeed, ch), 0);
+
+        //Constructing Waveforms for hybrid OpChannels (coated pmts)
+        if( pdtype == opdet::sbndPDMapAlg::PDType::kPMTCoated ){
+          pmtDigitizer->ConstructWaveformCoatedPMT(ch, waveform, direct, reflected, startTime, fConfig.Nsamples);
         }
         // uncoated PMTs
-        else if(Reflected && pdtype == "pmt_uncoated") {
+        else if(hasReflected && pdtype == opdet::sbndPDMapAlg::PDType::kPMTUncoated) {
           pmtDigitizer->ConstructWaveform(ch,
-                                          simphotons,
+                                          *reflected,
                                           waveform,
-                                          pdtype,
+                                          pdname,
                                           startTime,
                                           fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
         }
         // getting only xarapuca channels with appropriate type of light
-        if((pdtype == "xarapuca_vuv" && !Reflected) ||
-           (pdtype == "xarapuca_vis" && Reflected)) {
-          if(is_daphne){
+        else if((pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVUV && hasDirect) ||
+                (pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVIS && hasReflected)) {
+          const bool is_daphne = fConfig.pdsMap.isDaphne(ch);
           arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
-                                              waveform,
-                                              pdtype,
-                                              is_daphne,
-                                              startTime,
-                                              fConfig.Nsamples_Daphne);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
-        else{
-        arapucaDigitizer->ConstructWaveform(ch,
-                                              simphotons,
+                                              (pdtype == opdet::sbndPDMapAlg::PDType::kXArapucaVUV) ? *direct : *reflected,
                                               waveform,
-                                              pdtype,
+                                              pdname,
                                               is_daphne,
                                               startTime,
-                                              fConfig.Nsamples);
-          // including pre trigger window and transit time
-          fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                                  (unsigned int)ch,
-                                                  waveform);
-        }
+                                              is_daphne ? fConfig.Nsamples_Daphne : fConfig.Nsamples);
         }
-      }//optical channel loop
-    }//type of light loop
-    //Constructing Waveforms for hybrid OpChannels (coated pmts)
-    for(auto ch : coatedpmts_todigitize){
-      std::vector<short unsigned int> waveform;
-      waveform.reserve(fConfig.Nsamples);
-      pmtDigitizer->ConstructWaveformCoatedPMT(ch, waveform, DirectPhotonsMap, ReflectedPhotonsMap, startTime, fConfig.Nsamples);
-      fWaveforms->at(ch) = raw::OpDetWaveform(fConfig.EnableWindow[0],
-                                              (unsigned int)ch,
-                                              waveform);
+        else continue;
+
+        fWaveforms->at(ch) = std::move(waveform);
+        FindTriggerLocations(ch);
+      }
     }
   }//simphotons end
 }
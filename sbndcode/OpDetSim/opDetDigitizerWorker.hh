@@ -8,7 +8,8 @@
 #ifndef SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 #define SBND_OPDETSIM_OPDETDIGITIZERWORKER_HH
 
-#include <unordered_map>
+#include <algorithm>
+#include <atomic>
 #include <vector>
 #include <mutex>
 #include <condition_variable>
@@ -18,8 +19,10 @@
 #include "sbndcode/OpDetSim/DigiArapucaSBNDAlg.hh"
 #include "sbndcode/OpDetSim/DigiPMTSBNDAlg.hh"
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
+#include "sbndcode/OpDetSim/opDetPhotonViewSBND.hh"
 namespace detinfo {
   class DetectorClocksData;
+  class DetectorPropertiesData;
 }
 
 namespace opdet {
@@ -46,6 +49,10 @@ namespace opdet {
       unsigned int Nsamples; //Samples per waveform
       unsigned int Nsamples_Daphne; //Samples per waveform
 
+      bool FindTriggers = false; // find the trigger locations of each waveform made
+      raw::ADC_Count_t PMTBaseline;
+      raw::ADC_Count_t ArapucaBaseline;
+
       Config(const opdet::DigiPMTSBNDAlgMaker::Config &pmt_config, const opdet::DigiArapucaSBNDAlgMaker::Config &arapuca_config);
     };
 
@@ -61,51 +68,91 @@ namespace opdet {
       unsigned count;
     };
 
-    opDetDigitizerWorker(unsigned no, const Config &config, CLHEP::HepRandomEngine *Engine, const opDetSBNDTriggerAlg &trigger_alg);
+    // Channels are handed out to the workers in chunks from a shared
+    // counter, so that a worker busy with a bright channel does not hold up
+    // the others
+    class ChannelQueue {
+    public:
+      ChannelQueue(unsigned chunk_size = 1): fChunkSize(std::max(chunk_size, 1u)) {}
+      // only while no worker is running
+      void Reset(unsigned n_channels);
+      // next chunk [first, last), false once all channels are handed out
+      bool Next(unsigned &first, unsigned &last);
+
+    private:
+      std::atomic<unsigned> fNext{0};
+      unsigned fNChannels = 0;
+      unsigned fChunkSize;
+    };
+
+    opDetDigitizerWorker(unsigned no, const Config &config, CLHEP::HepRandomEngine *Engine, opDetSBNDTriggerAlg &trigger_alg);
     ~opDetDigitizerWorker();
 
-    void SetPhotonLiteHandles(const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *PhotonLiteHandles)
+    // photons of each channel, filled by the module before the workers start
+    void SetPhotonLiteView(const OpDetPhotonViewSBND<sim::SimPhotonsLite> *PhotonLiteView)
     {
-      fPhotonLiteHandles = PhotonLiteHandles;
+      fPhotonLiteView = PhotonLiteView;
     }
-    void SetPhotonHandles(const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *PhotonHandles)
+    void SetPhotonView(const OpDetPhotonViewSBND<sim::SimPhotons> *PhotonView)
     {
-      fPhotonHandles = PhotonHandles;
+      fPhotonView = PhotonView;
     }
     void SetWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
     {
       fWaveforms = Waveforms;
     }
-    void SetTriggeredWaveformHandle(std::vector<raw::OpDetWaveform> *Waveforms)
+    // triggered waveforms, one vector per channel
+    void SetTriggeredWaveformHandle(std::vector<std::vector<raw::OpDetWaveform>> *Waveforms)
     {
       fTriggeredWaveforms = Waveforms;
     }
+    void SetChannelQueue(ChannelQueue *Queue)
+    {
+      fChannelQueue = Queue;
+    }
+    // the random engine is reseeded for each channel from this seed and the
+    // channel number, so the waveforms do not depend on which worker made them
+    void SetEventSeedHandle(const long *EventSeed)
+    {
+      fEventSeed = EventSeed;
+    }
+    // per-event detector data used to find the triggers
+    void SetDetectorDataHandles(const detinfo::DetectorClocksData *const *ClockData,
+                                const detinfo::DetectorPropertiesData *const *DetProp)
+    {
+      fEventClockData = ClockData;
+      fEventDetProp = DetProp;
+    }
 
     void Start(detinfo::DetectorClocksData const& clockData) const;
     void ApplyTriggerLocations(detinfo::DetectorClocksData const& clockData) const;
 
+    // time spent working (as opposed to waiting for work) so far, in s
+    double BusyTime() const { return fBusyTime; }
+    void AddBusyTime(double t) const { fBusyTime += t; }
+
+    static long ChannelSeed(long event_seed, unsigned ch);
+
   private:
-    unsigned NChannelsToProcess(unsigned n) const;
-    unsigned StartChannelToProcess(unsigned n) const;
-    void CreateDirectPhotonMap(
-      std::unordered_map<int, sim::SimPhotons>& directPhotonsOnPMTS,
-      std::vector<art::Handle<std::vector<sim::SimPhotons>>> photon_handles) const;
-    void CreateDirectPhotonMapLite(
-      std::unordered_map<int, sim::SimPhotonsLite>& directPhotonsOnPMTS,
-      std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> photon_handles) const;
     void MakeWaveforms(
       opdet::DigiPMTSBNDAlg *pmtDigitizer,
       opdet::DigiArapucaSBNDAlg *arapucaDigitizer) const;
+    void FindTriggerLocations(unsigned ch) const;
 
     Config fConfig;
     unsigned fThreadNo;
     CLHEP::HepRandomEngine *fEngine;
-    const opDetSBNDTriggerAlg &fTriggerAlg;
+    opDetSBNDTriggerAlg &fTriggerAlg;
 
-    const std::vector<art::Handle<std::vector<sim::SimPhotonsLite>>> *fPhotonLiteHandles;
-    const std::vector<art::Handle<std::vector<sim::SimPhotons>>> *fPhotonHandles;
+    const OpDetPhotonViewSBND<sim::SimPhotonsLite> *fPhotonLiteView;
+    const OpDetPhotonViewSBND<sim::SimPhotons> *fPhotonView;
     std::vector<raw::OpDetWaveform> *fWaveforms;
-    std::vector<raw::OpDetWaveform> *fTriggeredWaveforms;
+    std::vector<std::vector<raw::OpDetWaveform>> *fTriggeredWaveforms;
+    ChannelQueue *fChannelQueue;
+    const long *fEventSeed;
+    const detinfo::DetectorClocksData *const *fEventClockData;
+    const detinfo::DetectorPropertiesData *const *fEventDetProp;
+    mutable double fBusyTime;
   };
 
   void StartopDetDigitizerWorkers(unsigned n_workers, opDetDigitizerWorker::Semaphore &sem_start);
@@ -0,0 +1,85 @@
+////////////////////////////////////////////////////////////////////////
+// File:        opDetNoiseSBND.hh
+//
+// Bulk generation of the line noise and of the dark counts of the
+// photon detector digitizers.
+//
+// The line noise is made a block of samples at a time: the flat numbers
+// of a block come from the engine in a single flatArray() call and are
+// turned into Gaussian ones with the Box-Muller transform, in loops with
+// no dependency between iterations. The dark counts of a waveform are a
+// Poisson number of uniform times, sorted, instead of a chain of
+// exponential intervals.
+//
+// The engine is the one of the digitizer, which opDetDigitizerWorker
+// reseeds for every channel. The distributions are the same as the ones
+// of the per sample CLHEP draws, the random numbers are not.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPDETNOISESBND_HH
+#define SBND_OPDETSIM_OPDETNOISESBND_HH
+
+#include "CLHEP/Random/RandomEngine.h"
+#include "CLHEP/Random/RandPoissonQ.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+namespace opdet {
+
+  class OpDetNoiseSBND {
+
+  public:
+
+    explicit OpDetNoiseSBND(CLHEP::HepRandomEngine* engine) : fEngine(engine) {}
+
+    // wave[i] += Gaussian number of mean 0 and standard deviation sigma
+    template <class T>
+    void AddLineNoise(std::vector<T>& wave, double sigma)
+    {
+      const double twoPi = 2.*M_PI;
+      double* u = fFlat.data();
+      double* g = fGaus.data();
+      for (size_t first = 0; first < wave.size(); first += kBlockSize) {
+        const size_t n = std::min(kBlockSize, wave.size() - first);
+        const size_t half = (n + 1)/2;
+        fEngine->flatArray(2*half, u);
+        // u[i] gives the radius and u[half+i] the angle of a pair
+        for (size_t i = 0; i < half; ++i) {
+          const double r = sigma*std::sqrt(-2.*std::log(u[i]));
+          const double phi = twoPi*u[half+i];
+          g[i] = r*std::cos(phi);
+          g[half+i] = r*std::sin(phi);
+        }
+        T* w = wave.data() + first;
+        for (size_t i = 0; i < n; ++i) w[i] += g[i];
+      }
+    }
+
+    // Sorted times in [0, length) of a Poisson process with meanCounts
+    // counts on average over that interval
+    std::vector<double> const& DarkCountTimes(double length, double meanCounts)
+    {
+      const long n = CLHEP::RandPoissonQ::shoot(fEngine, meanCounts);
+      fTimes.resize(n);
+      if (n > 0) fEngine->flatArray(n, fTimes.data());
+      for (auto& t : fTimes) t *= length;
+      std::sort(fTimes.begin(), fTimes.end());
+      return fTimes;
+    }
+
+  private:
+
+    static constexpr size_t kBlockSize = 256;  // samples per block of line noise
+
+    CLHEP::HepRandomEngine* fEngine;
+    std::array<double, kBlockSize> fFlat;
+    std::array<double, kBlockSize> fGaus;
+    std::vector<double> fTimes;
+  };
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPDETNOISESBND_HH
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////
+// File:        opDetPhotonViewSBND.hh
+//
+// Read-only view, indexed by channel, of the SimPhotons or SimPhotonsLite
+// records of all the photon products of an event, split into direct and
+// reflected light.
+//
+// The view points to the records of the products instead of copying them
+// and is filled once per event by opDetDigitizerSBND before the workers
+// start, which then only read it.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPDETPHOTONVIEWSBND_HH
+#define SBND_OPDETSIM_OPDETPHOTONVIEWSBND_HH
+
+#include "art/Framework/Principal/Handle.h"
+#include "art/Framework/Principal/Provenance.h"
+#include "lardataobj/Simulation/SimPhotons.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  inline int photonChannel(sim::SimPhotons const& photons) { return photons.OpChannel(); }
+  inline int photonChannel(sim::SimPhotonsLite const& photons) { return photons.OpChannel; }
+
+  template <class T>
+  class OpDetPhotonViewSBND {
+
+  public:
+
+    // Records of one channel and one type of light, in product order
+    class Records {
+    public:
+      Records(T const* const* first, T const* const* last) : fFirst(first), fLast(last) {}
+      T const* const* begin() const { return fFirst; }
+      T const* const* end() const { return fLast; }
+      size_t size() const { return fLast - fFirst; }
+      bool empty() const { return fFirst == fLast; }
+      T const& operator[](size_t i) const { return *fFirst[i]; }
+    private:
+      T const* const* fFirst;
+      T const* const* fLast;
+    };
+
+    // Index the records of the products; the ones with the "Reflected"
+    // instance name are reflected light, channels from nChannels on are
+    // left out
+    void Fill(std::vector<art::Handle<std::vector<T>>> const& handles, unsigned nChannels)
+    {
+      // counting sort on (channel, light), which keeps the product order
+      fFirst.assign(2*nChannels + 1, 0);
+      for (auto const& handle : handles) {
+        const size_t light = IsReflected(handle);
+        for (T const& photons : *handle) {
+          const int ch = photonChannel(photons);
+          if (ch >= 0 && (unsigned) ch < nChannels) fFirst[2*ch + light + 1]++;
+        }
+      }
+      for (size_t slot = 1; slot < fFirst.size(); ++slot) fFirst[slot] += fFirst[slot-1];
+
+      fRecords.resize(fFirst.back());
+      fNext.assign(fFirst.begin(), fFirst.end() - 1);
+      for (auto const& handle : handles) {
+        const size_t light = IsReflected(handle);
+        for (T const& photons : *handle) {
+          const int ch = photonChannel(photons);
+          if (ch >= 0 && (unsigned) ch < nChannels) fRecords[fNext[2*ch + light]++] = &photons;
+        }
+      }
+    }
+
+    Records Direct(unsigned ch) const { return Slot(2*ch); }
+    Records Reflected(unsigned ch) const { return Slot(2*ch + 1); }
+
+  private:
+
+    static bool IsReflected(art::Handle<std::vector<T>> const& handle)
+    {
+      return handle.provenance()->productInstanceName() == "Reflected";
+    }
+
+    Records Slot(size_t slot) const
+    {
+      if (slot + 1 >= fFirst.size()) return Records(nullptr, nullptr);
+      return Records(fRecords.data() + fFirst[slot], fRecords.data() + fFirst[slot+1]);
+    }
+
+    std::vector<T const*> fRecords; // by channel, direct then reflected light
+    std::vector<size_t> fFirst;     // first record of each (channel, light)
+    std::vector<size_t> fNext;      // fill position of each (channel, light)
+  };
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPDETPHOTONVIEWSBND_HH
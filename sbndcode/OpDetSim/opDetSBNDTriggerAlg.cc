@@ -1,6 +1,9 @@
 #include "sbndcode/OpDetSim/opDetSBNDTriggerAlg.hh"
 #include "lardataalg/DetectorInfo/DetectorClocksData.h"
 
+#include <algorithm>
+#include <queue>
+
 namespace {
   double optical_period(detinfo::DetectorClocksData const& clockData,bool is_daphne)
   {
@@ -15,16 +18,36 @@ namespace {
   {
     return waveform_start + waveform_index * optical_period(clockData,is_daphne);
   }
+
+  // First index in [first, last) whose sample passes pred, or last. The
+  // sample value is polarity * (adc - baseline), as in the trigger loop.
+  // Samples are tested a block at a time with no early exit inside the
+  // block, so the test compiles to vector compares; only the block holding
+  // the match is looked at sample by sample.
+  template <class Pred>
+  size_t find_first_sample(raw::ADC_Count_t const* adcs, size_t first, size_t last,
+                           int polarity, raw::ADC_Count_t baseline, Pred pred)
+  {
+    constexpr size_t kBlock = 32;
+    size_t i = first;
+    for (; i + kBlock <= last; i += kBlock) {
+      int any = 0;
+      for (size_t j = 0; j < kBlock; j++) {
+        raw::ADC_Count_t val = polarity * (adcs[i+j] - baseline);
+        any |= pred(val);
+      }
+      if (any) break;
+    }
+    for (; i < last; i++) {
+      raw::ADC_Count_t val = polarity * (adcs[i] - baseline);
+      if (pred(val)) return i;
+    }
+    return last;
+  }
 }
 
 namespace opdet {
 
-struct TriggerPrimitive {
-  raw::TimeStamp_t start;
-  raw::TimeStamp_t finish;
-  raw::Channel_t channel;
-};
-
 // Local static functions
 // Adds a value to a vector of trigger locations, while keeping the vector sorted
 void AddTriggerLocation(std::vector<std::array<raw::TimeStamp_t, 2>> &triggers, std::array<raw::TimeStamp_t,2> range) {
@@ -35,15 +58,7 @@ void AddTriggerLocation(std::vector<std::array<raw::TimeStamp_t, 2>> &triggers,
   triggers.insert(insert, range);
 }
 
-void AddTriggerPrimitive(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
-  typedef std::vector<TriggerPrimitive> TimeStamps;
-
-  TimeStamps::iterator insert = std::lower_bound(triggers.begin(), triggers.end(), trigger,
-    [](auto const &lhs, auto const &rhs) { return lhs.start < rhs.start; });
-
-  triggers.insert(insert, trigger);
-}
-
+template <class TriggerPrimitive>
 void AddTriggerPrimitiveFinish(std::vector<TriggerPrimitive> &triggers, TriggerPrimitive trigger) {
   typedef std::vector<TriggerPrimitive> TimeStamps;
   
@@ -58,28 +73,28 @@ opDetSBNDTriggerAlg::opDetSBNDTriggerAlg(const Config &config):
 {
   // setup the masked channels
   fConfig.MaskedChannels(fMaskedChannels);
+
+  fTriggerRangesPerChannel.resize(fOpDetMap.size());
+  fTriggerLocationsPerChannel.resize(fOpDetMap.size());
+  fWorkerTriggerPrimitives.resize(1);
+}
+
+void opDetSBNDTriggerAlg::SetNWorkers(unsigned n_workers) {
+  fWorkerTriggerPrimitives.resize(std::max(n_workers, 1u));
 }
 
 void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
                                                detinfo::DetectorPropertiesData const& detProp,
-                                               const raw::OpDetWaveform &waveform, raw::ADC_Count_t baseline) {
-  std::vector<std::array<raw::TimeStamp_t, 2>> this_trigger_ranges;
+                                               const raw::OpDetWaveform &waveform, raw::ADC_Count_t baseline,
+                                               unsigned worker) {
   const std::vector<raw::ADC_Count_t> &adcs = waveform; // upcast to get adcs
   raw::Channel_t channel = waveform.ChannelNumber();
-  // if (channel > (unsigned)fOpDetMap.size()) return;
-
-  // initialize the channel in the map no matter what
-  if (fTriggerRangesPerChannel.count(channel) == 0) {
-    fTriggerRangesPerChannel[channel] = std::vector<std::array<raw::TimeStamp_t,2>>();
-  }
+  std::vector<std::array<raw::TimeStamp_t, 2>> &channel_ranges = fTriggerRangesPerChannel.at(channel);
   
   // get the threshold -- first check if channel is Arapuca or PMT
-  std::string opdet_type = fOpDetMap.pdType(channel);
-  bool is_arapuca = false;
-  if( opdet_type.find("arapuca") != std::string::npos ) is_arapuca = true; 
-  bool is_daphne = false;
-  std::string sampling_type = fOpDetMap.electronicsType(channel);
-  if (sampling_type == "daphne") is_daphne = true;
+  opdet::sbndPDMapAlg::ChannelRecord const& channel_record = fOpDetMap.channelRecord(channel);
+  bool is_arapuca = channel_record.isArapuca;
+  bool is_daphne = channel_record.isDaphne;
 
   int threshold = is_arapuca ? fConfig.TriggerThresholdADCArapuca() : fConfig.TriggerThresholdADCPMT(); 
   int polarity = is_arapuca ? fConfig.PulsePolarityArapuca() : fConfig.PulsePolarityPMT(); 
@@ -117,25 +132,67 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
                                                      detProp,
                                                      tick_to_timestamp(clockData, waveform.TimeStamp(), end_i+1,is_daphne)));
 
+  // The loop below only stops at the samples where the state can change:
+  // while no trigger is open, the next sample above threshold after the
+  // holdoff; while a trigger is open, the next sample below threshold (or
+  // the last but one sample); and the sample(s) matching the beam trigger
+  // time. Everything in between is skipped with find_first_sample().
+  // The holdoff clock is advanced one period at a time, exactly as it was
+  // when every sample was visited, so the trigger times do not change.
+  const double period = optical_period(clockData, is_daphne);
+  const raw::TimeStamp_t waveform_start = waveform.TimeStamp();
+  auto sample_time = [&](size_t i) -> raw::TimeStamp_t { return waveform_start + i * period; };
+  auto above = [threshold](raw::ADC_Count_t val) { return val > threshold; };
+  auto below = [threshold](raw::ADC_Count_t val) { return val < threshold; };
+
+  // samples close enough to the beam trigger time
+  std::vector<size_t> beam_samples;
+  if (fConfig.BeamTriggerEnable()) {
+    double beam_i = (fConfig.BeamTriggerTime() - waveform_start) / period;
+    if (beam_i > (double)start_i - 2. && beam_i < (double)end_i + 2.) {
+      size_t first = (size_t)std::max(0., std::floor(beam_i) - 1.);
+      for (size_t i = std::max(first, start_i); i <= std::min(first + 3, end_i); i++) {
+        if (fabs(sample_time(i)-fConfig.BeamTriggerTime()) <= period/2.) beam_samples.push_back(i);
+      }
+    }
+  }
+
   std::vector<std::array<raw::TimeStamp_t, 2>> this_trigger_locations; 
   bool above_threshold = false;
   bool beam_trigger_added = false;
   double t_since_last_trigger = 99999.; //[us]
   double t_deadtime = fConfig.TriggerHoldoff();
+  bool is_live = false;
+  size_t next_clock_i = start_i; // next sample to add to t_since_last_trigger
   raw::TimeStamp_t trigger_start;
-  // find all ADC counts above threshold
-  for (size_t i = start_i; i <= end_i; i++) {
-    raw::TimeStamp_t time = tick_to_timestamp(clockData, waveform.TimeStamp(),i,is_daphne);
-    t_since_last_trigger += optical_period(clockData,is_daphne);
-    bool isLive = (t_since_last_trigger > t_deadtime);
-    raw::ADC_Count_t val = polarity * (adcs.at(i) - baseline);
+
+  // advance the holdoff clock up to sample i, or until it goes live
+  auto advance_clock = [&](size_t i) {
+    while (!is_live && next_clock_i <= i) {
+      t_since_last_trigger += period;
+      next_clock_i++;
+      is_live = (t_since_last_trigger > t_deadtime);
+    }
+    return is_live;
+  };
+  auto restart_clock = [&](size_t i, double deadtime) {
+    t_since_last_trigger = 0;
+    t_deadtime = deadtime;
+    next_clock_i = i + 1;
+    is_live = false;
+  };
+
+  size_t i = start_i;
+  while (i <= end_i) {
+    raw::TimeStamp_t time = sample_time(i);
+    bool isLive = advance_clock(i);
+    raw::ADC_Count_t val = polarity * (adcs[i] - baseline);
     // only open new trigger if enough deadtime has passed
     if (isLive && !above_threshold && val > threshold) {
       // new trigger! -- get the time
       trigger_start = time;
       above_threshold = true;
-      t_since_last_trigger = 0;
-      t_deadtime = fConfig.TriggerHoldoff();
+      restart_clock(i, fConfig.TriggerHoldoff());
     }
     else if (above_threshold && (val < threshold || i+1 == end_i)) {
       raw::TimeStamp_t trigger_finish = time;
@@ -145,11 +202,38 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
     // add beam trigger (if enabled)
     // since the clock ticks might not sync up exactly, use the closet sample
     if( isLive && fConfig.BeamTriggerEnable() && !beam_trigger_added &&
-      fabs(time-fConfig.BeamTriggerTime()) <= optical_period(clockData,is_daphne)/2. ){
+      fabs(time-fConfig.BeamTriggerTime()) <= period/2. ){
       AddTriggerLocation(this_trigger_locations, {{time,time}});
       beam_trigger_added = true;
-      t_since_last_trigger = 0;
-      t_deadtime = fConfig.BeamTriggerHoldoff();
+      restart_clock(i, fConfig.BeamTriggerHoldoff());
+    }
+
+    // find the next sample where something can happen
+    size_t first = i + 1;
+    if (!above_threshold) {
+      // nothing can be triggered before the holdoff is over
+      if (!advance_clock(end_i)) break;
+      first = std::max(first, next_clock_i - 1);
+    }
+    size_t next = end_i + 1;
+    if (!beam_trigger_added) {
+      auto beam_it = std::lower_bound(beam_samples.begin(), beam_samples.end(), first);
+      if (beam_it != beam_samples.end()) next = *beam_it;
+    }
+    if (above_threshold && end_i > first) next = std::min(next, end_i - 1);
+    if (first < next) {
+      next = above_threshold ?
+        find_first_sample(adcs.data(), first, next, polarity, baseline, below) :
+        find_first_sample(adcs.data(), first, next, polarity, baseline, above);
+    }
+    i = next;
+  }
+
+  // Keep the triggers of unmasked channels for the global trigger
+  if (!fConfig.SelfTriggerPerChannel() && !IsChannelMasked(channel)) {
+    std::vector<TriggerPrimitive> &primitives = fWorkerTriggerPrimitives.at(worker);
+    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_locations) {
+      primitives.push_back({trigger_range[0], trigger_range[1], channel});
     }
   }
 
@@ -157,13 +241,13 @@ void opDetSBNDTriggerAlg::FindTriggerLocations(detinfo::DetectorClocksData const
   //
   // Small speed optimization: if this is the first time we are setting the 
   // trigger times for the channel, just move the vector we already built
-  if (fTriggerRangesPerChannel[channel].size() == 0) {
-    fTriggerRangesPerChannel[channel] = std::move(this_trigger_locations);
+  if (channel_ranges.size() == 0) {
+    channel_ranges = std::move(this_trigger_locations);
   }
   // Otherwise, merge them in and keep things sorted in time
   else {
-    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_ranges) {
-      AddTriggerLocation(fTriggerRangesPerChannel[channel], trigger_range);
+    for (const std::array<raw::TimeStamp_t, 2> &trigger_range: this_trigger_locations) {
+      AddTriggerLocation(channel_ranges, trigger_range);
     }
   }
 
@@ -175,24 +259,20 @@ bool opDetSBNDTriggerAlg::IsChannelMasked(raw::Channel_t channel) const {
   if (in_masked_list) return true;
 
   // mask by optical detector type
-  std::string opdet_type = fOpDetMap.pdType(channel);
-  if (opdet_type == "bar" && fConfig.MaskLightBars() /* RIP */) return true;
-  if (opdet_type == "pmt_coated" && fConfig.MaskPMTs()) return true;
-  if (opdet_type == "pmt_uncoated" && fConfig.MaskBarePMTs()) return true;
-  if (opdet_type == "xarapucaprime" && fConfig.MaskXArapucaPrimes()) return true;
-  if (opdet_type == "xarapuca" && fConfig.MaskXArapucas()) return true;
-  if (opdet_type == "xarapuca_vuv" && fConfig.MaskXArapucas()) return true;
-  if (opdet_type == "xarapuca_vis" && fConfig.MaskXArapucas()) return true;
-  if (opdet_type == "xarapucaT1" && fConfig.MaskXArapucas()) return true;
-  if (opdet_type == "xarapucaT2" && fConfig.MaskXArapucas()) return true;
-  if (opdet_type == "arapucaT1" && fConfig.MaskArapucaT1s()) return true;
-  if (opdet_type == "arapucaT2" && fConfig.MaskArapucaT2s()) return true;
-  return false;
+  // (light bars, X-ARAPUCA primes and ARAPUCA T1/T2 are no longer in the map)
+  switch (fOpDetMap.pdTypeOf(channel)) {
+    case opdet::sbndPDMapAlg::PDType::kPMTCoated:    return fConfig.MaskPMTs();
+    case opdet::sbndPDMapAlg::PDType::kPMTUncoated:  return fConfig.MaskBarePMTs();
+    case opdet::sbndPDMapAlg::PDType::kXArapucaVUV:
+    case opdet::sbndPDMapAlg::PDType::kXArapucaVIS:  return fConfig.MaskXArapucas();
+    default: return false;
+  }
 }
 
 void opDetSBNDTriggerAlg::ClearTriggerLocations() {
-  fTriggerLocationsPerChannel.clear();
-  fTriggerRangesPerChannel.clear();
+  for (auto &locations: fTriggerLocationsPerChannel) locations.clear();
+  for (auto &ranges: fTriggerRangesPerChannel) ranges.clear();
+  for (auto &primitives: fWorkerTriggerPrimitives) primitives.clear();
   fTriggerLocations.clear();
 }
 
@@ -200,10 +280,10 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
   // If each channel is self triggered, there is no "master" set of triggers, and 
   // we don't need to do anything here
   if (fConfig.SelfTriggerPerChannel()) {
-    for (const auto &trigger_ranges: fTriggerRangesPerChannel) {
-      fTriggerLocationsPerChannel[trigger_ranges.first] = std::vector<raw::TimeStamp_t>();
-      for (const std::array<raw::TimeStamp_t, 2> &range: trigger_ranges.second) {
-        fTriggerLocationsPerChannel[trigger_ranges.first].push_back(range[0]);
+    for (size_t channel = 0; channel < fTriggerRangesPerChannel.size(); channel++) {
+      fTriggerLocationsPerChannel[channel].clear();
+      for (const std::array<raw::TimeStamp_t, 2> &range: fTriggerRangesPerChannel[channel]) {
+        fTriggerLocationsPerChannel[channel].push_back(range[0]);
       }
     }
     return;
@@ -217,21 +297,40 @@ void opDetSBNDTriggerAlg::MergeTriggerLocations() {
   // so we implement a small generic algorithm here. This may likely have
   // to be changed later.
 
-  // First re-sort the trigger times to be a sorted global list of (channel, time) values
+  // First re-sort the trigger times to be a sorted global list of (channel, time) values.
+  // The triggers of the unmasked channels were collected per worker in
+  // FindTriggerLocations: sort each buffer and merge them all in one k-way merge.
+  // Ties are broken by channel, so that the order does not depend on which
+  // worker saw which channel.
+  auto earlier = [](const TriggerPrimitive &lhs, const TriggerPrimitive &rhs) {
+    if (lhs.start != rhs.start) return lhs.start < rhs.start;
+    if (lhs.channel != rhs.channel) return lhs.channel < rhs.channel;
+    return lhs.finish < rhs.finish;
+  };
+  size_t n_primitives = 0;
+  for (std::vector<TriggerPrimitive> &primitives: fWorkerTriggerPrimitives) {
+    std::sort(primitives.begin(), primitives.end(), earlier);
+    n_primitives += primitives.size();
+  }
+
+  // heap of the next primitive of each worker buffer, as (worker, index)
+  typedef std::pair<size_t, size_t> Cursor;
+  auto later = [this, &earlier](const Cursor &lhs, const Cursor &rhs) {
+    return earlier(fWorkerTriggerPrimitives[rhs.first][rhs.second],
+                   fWorkerTriggerPrimitives[lhs.first][lhs.second]);
+  };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(later)> heads(later);
+  for (size_t worker = 0; worker < fWorkerTriggerPrimitives.size(); worker++) {
+    if (!fWorkerTriggerPrimitives[worker].empty()) heads.push({worker, 0});
+  }
+
   std::vector<TriggerPrimitive> all_trigger_locations;
-  for (const auto &trigger_locations_pair: fTriggerRangesPerChannel) {
-    raw::Channel_t this_channel = trigger_locations_pair.first;
-    // check if this channel contributes to the trigger
-    if (!IsChannelMasked(this_channel)) {
-      // then add in the locations
-      for (std::array<raw::TimeStamp_t,2> trigger_range: trigger_locations_pair.second) {
-        TriggerPrimitive trigger;
-        trigger.start = trigger_range[0];
-        trigger.finish = trigger_range[1];
-        trigger.channel = this_channel;
-        AddTriggerPrimitive(all_trigger_locations, trigger);
-      }
-    }
+  all_trigger_locations.reserve(n_primitives);
+  while (!heads.empty()) {
+    Cursor head = heads.top();
+    heads.pop();
+    all_trigger_locations.push_back(fWorkerTriggerPrimitives[head.first][head.second]);
+    if (++head.second < fWorkerTriggerPrimitives[head.first].size()) heads.push(head);
   }
 
   // Now merge the trigger locations we have 
@@ -339,9 +438,7 @@ std::vector<raw::OpDetWaveform> opDetSBNDTriggerAlg::ApplyTriggerLocations(detin
   raw::Channel_t channel = waveform.ChannelNumber();
   const std::vector<raw::TimeStamp_t> &trigger_times = GetTriggerTimes(channel);
   if( trigger_times.size() == 0 ) return ret;
-  bool is_daphne = false;
-  std::string sampling_type = fOpDetMap.electronicsType(channel);
-  if (sampling_type == "daphne") is_daphne = true;
+  bool is_daphne = fOpDetMap.isDaphne(channel);
 
 
 //  std::cout
@@ -245,16 +245,26 @@ namespace opdet {
       opDetSBNDTriggerAlg(fhicl::Table<Config>(pset, {})())
     {}
 
+    // Number of threads that will call FindTriggerLocations, each with its
+    // own worker index; must not be called while triggers are being found
+    void SetNWorkers(unsigned n_workers);
+
     // Clear out at the end of an event
     void ClearTriggerLocations();
 
     // Add in a waveform to define trigger locations
+    //
+    // Different workers may call this at the same time, as long as they
+    // are given waveforms of different channels: each call only writes to
+    // the entry of its channel and to the buffer of its worker.
     void FindTriggerLocations(detinfo::DetectorClocksData const& clockData,
                               detinfo::DetectorPropertiesData const& detProp,
                               const raw::OpDetWaveform &waveform,
-                              raw::ADC_Count_t baseline);
+                              raw::ADC_Count_t baseline,
+                              unsigned worker = 0);
 
     // Merge all of the triggers together
+    // (after all the calls to FindTriggerLocations are done)
     void MergeTriggerLocations();
 
     // Apply trigger locations to an input OpDetWaveform
@@ -266,6 +276,12 @@ namespace opdet {
 
   private:
 
+    struct TriggerPrimitive {
+      raw::TimeStamp_t start;
+      raw::TimeStamp_t finish;
+      raw::Channel_t channel;
+    };
+
     // internal functions
     bool IsChannelMasked(raw::Channel_t channel) const;
     bool IsTriggerEnabled(detinfo::DetectorClocksData const& clockData,
@@ -285,11 +301,15 @@ namespace opdet {
     // OpDet channel map
     opdet::sbndPDMapAlg fOpDetMap;
 
-    // keeping track of triggers
-    std::map<raw::Channel_t, std::vector<std::array<raw::TimeStamp_t, 2>>> fTriggerRangesPerChannel;
-    std::map<raw::Channel_t, std::vector<raw::TimeStamp_t>> fTriggerLocationsPerChannel;
+    // keeping track of triggers, indexed by channel
+    std::vector<std::vector<std::array<raw::TimeStamp_t, 2>>> fTriggerRangesPerChannel;
+    std::vector<std::vector<raw::TimeStamp_t>> fTriggerLocationsPerChannel;
     std::vector<raw::TimeStamp_t> fTriggerLocations;
 
+    // triggers of the unmasked channels seen by each worker, for the global
+    // trigger; sorted and merged in MergeTriggerLocations
+    std::vector<std::vector<TriggerPrimitive>> fWorkerTriggerPrimitives;
+
     std::vector<unsigned> fMaskedChannels;
 
   };//class opDetSBNDTriggerAlg
@@ -39,6 +39,7 @@
 
 #include <memory>
 #include <algorithm>
+#include <chrono>
 #include <vector>
 #include "TMath.h"
 #include "TH1D.h"
@@ -46,6 +47,9 @@
 #include "TF1.h"
 
 #include "sbndcode/OpDetSim/sbndPDMapAlg.hh"
+#include "sbndcode/OpDetSim/opHitPeakFinderSBND.hh"
+#include "sbndcode/Utilities/BaselineUtilsSBND.h"
+#include "sbndcode/Utilities/ThreadUtilsSBND.h"
 
 namespace opdet {
 
@@ -65,6 +69,7 @@ namespace opdet {
 
     // Required functions.
     void produce(art::Event & e) override;
+    void endJob() override;
     opdet::sbndPDMapAlg map; //map for photon detector types
 
   private:
@@ -84,25 +89,66 @@ namespace opdet {
     int fThresholdPMT; //in ADC
     int fThresholdArapuca; //in ADC
     int fEvNumber;
-    int fChNumber;
-    std::string opdetType;
-    std::string electronicsType;
-    int threshold;
-    std::vector<double> fwaveform;
-    std::vector<double> outwvform;
+    unsigned fNThreads; //threads to share the waveforms of an event
+
+    // Iterative: take the highest sample, integrate and zero its peak, repeat
+    // SinglePass: find all the peaks in one scan (opHitPeakFinderSBND.hh)
+    enum class PeakFinder { kIterative, kSinglePass };
+    PeakFinder fPeakFinder;
+    bool fBenchmarkPeakFinders; //run both finders, compare and time them
+
+    // FirstSamples: mean of the first BaselineSample ticks
+    // Mode: mode of the whole waveform, refined by the mean of the samples
+    // within BaselineModeWindow of it (BaselineUtilsSBND.h)
+    enum class BaselineEstimator { kFirstSamples, kMode };
+    BaselineEstimator fBaselineEstimator;
+    double fBaselineModeWindow; //in ADC
+
+    // Work area of one thread, kept across events so that the buffers are
+    // only allocated while they grow
+    struct Workspace {
+      std::vector<float> waveform;
+      std::vector<float> outwvform;
+      std::vector<float> blockMax; //maximum of each block of waveform, see findAndSuppressPeak
+      std::vector<opdet::OpHitPeak> peaks;
+      std::vector<opdet::OpHitPeak> otherPeaks; //from the other finder, when benchmarking
+      std::vector<recob::OpHit> hits; //hits of the waveforms given to this thread
+      util::ModeHistogramSBND baselineHist;
+
+      // benchmark of the peak finders
+      size_t nBenchWaveforms = 0;
+      size_t nBenchMismatches = 0;
+      double timeIterative = 0.; //s
+      double timeSinglePass = 0.; //s
+    };
+    std::vector<Workspace> fWorkspaces;
+    static constexpr size_t kPeakBlockSize = 64; //samples per entry of Workspace::blockMax
+
+    // Where the hits of one waveform are in the Workspace::hits of a thread
+    struct HitRange {
+      unsigned worker = 0;
+      size_t begin = 0;
+      size_t end = 0;
+    };
+
     //int fSize;
     //int fTimePMT;         //Start time of PMT signal
     //int fTimeMax;         //Time of maximum (minimum) PMT signal
-    void subtractBaseline(std::vector<double>& waveform, std::string pdtype, std::string electronicsType, double& rms);
-    bool findAndSuppressPeak(std::vector<double>& waveform, size_t& timebin,
-                             double& Area, double& amplitude,
-                             const int& threshold, const std::string& opdetType, const std::string& electronicsType);
-    void denoise(std::vector<double>& waveform, std::vector<double>& outwaveform);
-    bool TV1D_denoise(std::vector<double>& waveform,
-                      std::vector<double>& outwaveform,
-                      const double lambda);
-    void TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                         unsigned int width, const double lambda);
+    void findHits(raw::OpDetWaveform const& wvf, Workspace& ws) const;
+    void subtractBaseline(std::vector<float>& waveform, opdet::sbndPDMapAlg::ChannelRecord const& channel,
+                          Workspace& ws, double& rms) const;
+    void computeBlockMax(std::vector<float> const& waveform, std::vector<float>& blockMax,
+                         size_t first, size_t last) const;
+    bool findAndSuppressPeak(std::vector<float>& waveform, std::vector<float>& blockMax,
+                             opdet::OpHitPeak& peak, const int& threshold) const;
+    void findPeaks(std::vector<float>& waveform, int threshold, PeakFinder finder,
+                   Workspace& ws, std::vector<opdet::OpHitPeak>& peaks) const;
+    void denoise(std::vector<float>& waveform, std::vector<float>& outwaveform) const;
+    bool TV1D_denoise(std::vector<float>& waveform,
+                      std::vector<float>& outwaveform,
+                      const double lambda) const;
+    void TV1D_denoise_v2(std::vector<float>& input, std::vector<float>& output,
+                         unsigned int width, const double lambda) const;
     //std::stringstream histname;
   };
 
@@ -120,6 +166,22 @@ namespace opdet {
     fPulsePolarityPMT = p.get< int   >("PulsePolarityPMT");
     fPulsePolarityArapuca = p.get<int>("PulsePolarityArapuca");
     fUseDenoising     = p.get< bool  >("UseDenoising");
+    fNThreads = util::ResolveNThreads(p.get< unsigned >("NThreads", 1), "SBNDCODE_OPHITFINDER_NTHREADS", "opHitFinder");
+    fWorkspaces.resize(fNThreads);
+
+    std::string peakFinder = p.get< std::string >("PeakFinder", "SinglePass");
+    if(peakFinder == "SinglePass") fPeakFinder = PeakFinder::kSinglePass;
+    else if(peakFinder == "Iterative") fPeakFinder = PeakFinder::kIterative;
+    else throw cet::exception("opHitFinder") << "Unknown PeakFinder '" << peakFinder
+                                             << "', use \"SinglePass\" or \"Iterative\".\n";
+    fBenchmarkPeakFinders = p.get< bool >("BenchmarkPeakFinders", false);
+
+    std::string baselineEstimator = p.get< std::string >("BaselineEstimator", "FirstSamples");
+    if(baselineEstimator == "FirstSamples") fBaselineEstimator = BaselineEstimator::kFirstSamples;
+    else if(baselineEstimator == "Mode") fBaselineEstimator = BaselineEstimator::kMode;
+    else throw cet::exception("opHitFinder") << "Unknown BaselineEstimator '" << baselineEstimator
+                                             << "', use \"FirstSamples\" or \"Mode\".\n";
+    fBaselineModeWindow = p.get< double >("BaselineModeWindow", 2.); //in ADC
 
     auto const clockData = art::ServiceHandle<detinfo::DetectorClocksService const>()->DataForJob();
     fSampling = clockData.OpticalClock().Frequency(); // MHz
@@ -136,8 +198,6 @@ namespace opdet {
     mf::LogInfo("opHitFinder") << "Event #" << fEvNumber;
 
     std::unique_ptr< std::vector< recob::OpHit > > pulseVecPtr(std::make_unique< std::vector< recob::OpHit > > ());
-    fwaveform.reserve(30000); // TODO: no hardcoded value
-    outwvform.reserve(30000); // TODO: no hardcoded value
 
     art::ServiceHandle<art::TFileService> tfs;
     art::Handle< std::vector< raw::OpDetWaveform > > wvfHandle;
@@ -149,88 +209,142 @@ namespace opdet {
       mf::LogWarning("opHitFinder") << Form("Did not find any waveform");
     }
 
-    size_t timebin = 0;
-    double FWHM = 1, Area = 0, phelec, fasttotal = 3./4., rms = 0, amplitude = 0, time = 0;
+    // The waveforms are shared out among the threads; each thread appends
+    // the hits to its own workspace, and they are put back together in the
+    // order of the input waveforms.
+    for(Workspace& ws : fWorkspaces) ws.hits.clear();
+    std::vector<HitRange> hitRanges(wvfList.size());
+    util::ParallelForEach(fNThreads, wvfList.size(),
+      [&](size_t i, unsigned worker) {
+        Workspace& ws = fWorkspaces[worker];
+        hitRanges[i].worker = worker;
+        hitRanges[i].begin = ws.hits.size();
+        findHits(*wvfList[i], ws);
+        hitRanges[i].end = ws.hits.size();
+      });
+
+    size_t nHits = 0;
+    for(Workspace const& ws : fWorkspaces) nHits += ws.hits.size();
+    pulseVecPtr->reserve(nHits);
+    for(HitRange const& range : hitRanges) {
+      std::vector<recob::OpHit> const& hits = fWorkspaces[range.worker].hits;
+      pulseVecPtr->insert(pulseVecPtr->end(), hits.begin() + range.begin, hits.begin() + range.end);
+    }
+    e.put(std::move(pulseVecPtr));
+  } // void opHitFinderSBND::produce(art::Event & e)
+
+  void opHitFinderSBND::endJob()
+  {
+    if(!fBenchmarkPeakFinders) return;
+    size_t nWaveforms = 0, nMismatches = 0;
+    double timeIterative = 0., timeSinglePass = 0.;
+    for(Workspace const& ws : fWorkspaces) {
+      nWaveforms += ws.nBenchWaveforms;
+      nMismatches += ws.nBenchMismatches;
+      timeIterative += ws.timeIterative;
+      timeSinglePass += ws.timeSinglePass;
+    }
+    mf::LogInfo("opHitFinder") << "Peak finder benchmark over " << nWaveforms << " waveforms:"
+                               << "\n  Iterative:  " << timeIterative << " s"
+                               << "\n  SinglePass: " << timeSinglePass << " s"
+                               << "\n  waveforms with different hits: " << nMismatches;
+  } // void opHitFinderSBND::endJob()
+
+  void opHitFinderSBND::findHits(raw::OpDetWaveform const& wvf, Workspace& ws) const
+  {
+    double FWHM = 1, Area = 0, phelec, fasttotal = 3./4., rms = 0, time = 0;
     unsigned short frame = 1;
-    //int histogram_number = 0;
-    for(auto const& wvf_P : wvfList) {
-      auto const& wvf = *wvf_P;
-      if (wvf.size() == 0 ) {
-        mf::LogInfo("opHitFinder") << "Empty waveform, continue.";
-        continue;
-      }
+    int threshold;
+    if (wvf.size() == 0 ) {
+      mf::LogInfo("opHitFinder") << "Empty waveform, continue.";
+      return;
+    }
 
-      fChNumber = wvf.ChannelNumber();
-      opdetType = map.pdType(fChNumber);
-      electronicsType = map.electronicsType(fChNumber);
-      if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
-        threshold = fThresholdPMT;
+    int chNumber = wvf.ChannelNumber();
+    opdet::sbndPDMapAlg::ChannelRecord const& channel = map.channelRecord(chNumber);
+    if(channel.isPMT) {
+      threshold = fThresholdPMT;
+    }
+    else if(channel.isArapuca) {
+      threshold = fThresholdArapuca;
+    }
+    else {
+      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << map.pdType(chNumber);
+      return;
+    }
+
+    std::vector<float>& waveform = ws.waveform;
+    waveform.assign(wvf.begin(), wvf.end());
+
+    subtractBaseline(waveform, channel, ws, rms);
+
+    if(fUseDenoising && channel.isArapuca) {
+      denoise(waveform, ws.outwvform);
+    }
+
+    // TODO: pass rms to the peak finders once that's sorted. ~icaza
+    if(fBenchmarkPeakFinders) {
+      // the single pass finder leaves the waveform untouched, so it goes first
+      auto const start = std::chrono::steady_clock::now();
+      findPeaks(waveform, threshold, PeakFinder::kSinglePass, ws, ws.peaks);
+      auto const middle = std::chrono::steady_clock::now();
+      findPeaks(waveform, threshold, PeakFinder::kIterative, ws, ws.otherPeaks);
+      auto const end = std::chrono::steady_clock::now();
+      ws.timeSinglePass += std::chrono::duration<double>(middle - start).count();
+      ws.timeIterative += std::chrono::duration<double>(end - middle).count();
+      ws.nBenchWaveforms++;
+      bool same = (ws.peaks.size() == ws.otherPeaks.size());
+      for(size_t i = 0; same && i < ws.peaks.size(); i++) {
+        opdet::OpHitPeak const& a = ws.peaks[i];
+        opdet::OpHitPeak const& b = ws.otherPeaks[i];
+        same = (a.first == b.first && a.last == b.last && a.peak == b.peak &&
+                a.amplitude == b.amplitude && a.sum == b.sum);
       }
-      else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-        threshold = fThresholdArapuca;
+      if(!same) ws.nBenchMismatches++;
+      if(fPeakFinder == PeakFinder::kIterative) std::swap(ws.peaks, ws.otherPeaks);
+    }
+    else {
+      findPeaks(waveform, threshold, fPeakFinder, ws, ws.peaks);
+    }
+
+    for(opdet::OpHitPeak const& peak : ws.peaks){
+      // area below the peak
+      // note that fSampling is in MHz and
+      // we convert it to GHz here so as to
+      // have an area in ADC*ns.
+      Area = peak.sum;
+      if(channel.isDaphne) {
+        Area = Area / (fSampling_Daphne / 1000.);
+        time = wvf.TimeStamp() + (double)peak.peak / fSampling_Daphne;
       }
       else {
-        mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
-        continue;
+        Area = Area / (fSampling / 1000.);
+        time = wvf.TimeStamp() + (double)peak.peak / fSampling;
       }
 
-      fwaveform.resize(wvf.size());
-      for(unsigned int i = 0; i < wvf.size(); i++) {
-        fwaveform[i] = wvf[i];
+      if(channel.isPMT) {
+        phelec = Area / fArea1pePMT;
       }
-
-      subtractBaseline(fwaveform, opdetType, electronicsType, rms);
-
-      if(fUseDenoising) {
-        if((opdetType == "pmt_coated") || (opdetType == "pmt_uncoated")) {
-        }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-          denoise(fwaveform, outwvform);
-        }
-        else {
-          mf::LogInfo("opHitFinder") << "Unexpected OpChannel: " << opdetType
-                    << ", continue." << std::endl;
-          std::terminate();
-        }
+      else {
+        phelec = Area / fArea1peSiPM;
       }
 
-      // TODO: pass rms to this function once that's sorted. ~icaza
-      while(findAndSuppressPeak(fwaveform, timebin, Area, amplitude, threshold, opdetType, electronicsType)){
-        if(electronicsType == "daphne") time = wvf.TimeStamp() + (double)timebin / fSampling_Daphne;
-        else time = wvf.TimeStamp() + (double)timebin / fSampling;
-
-        if(opdetType == "pmt_coated" || opdetType == "pmt_uncoated") {
-          phelec = Area / fArea1pePMT;
-        }
-        else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
-          phelec = Area / fArea1peSiPM;
-        }
-        else {
-          mf::LogWarning("opHitFinder")  << "Unexpected OpChannel: " << opdetType
-                                         << ", continue.";
-          continue;
-        }
-
-        //including hit info: OpChannel, PeakTime, PeakTimeAbs, Frame, Width, Area, PeakHeight, PE, FastToTotal
-        recob::OpHit opHit(fChNumber, time, time, frame, FWHM, Area, amplitude, phelec, fasttotal);
-        pulseVecPtr->emplace_back(opHit);
-      } // while findAndSuppressPeak()
-    } // for(auto const& wvf : (*wvfHandle)){
-    e.put(std::move(pulseVecPtr));
-    std::vector<double>().swap(fwaveform); // clear and release the memory of fwaveform
-    std::vector<double>().swap(outwvform); // clear and release the memory of outwvform
-  } // void opHitFinderSBND::produce(art::Event & e)
+      //including hit info: OpChannel, PeakTime, PeakTimeAbs, Frame, Width, Area, PeakHeight, PE, FastToTotal
+      ws.hits.emplace_back(chNumber, time, time, frame, FWHM, Area, peak.amplitude, phelec, fasttotal);
+    } // for peaks
+  } // void opHitFinderSBND::findHits()
 
   DEFINE_ART_MODULE(opHitFinderSBND)
 
-  void opHitFinderSBND::subtractBaseline(std::vector<double>& waveform,
-                                         std::string pdtype, std::string electronicsType, double& rms)
+  void opHitFinderSBND::subtractBaseline(std::vector<float>& waveform,
+                                         opdet::sbndPDMapAlg::ChannelRecord const& channel,
+                                         Workspace& ws, double& rms) const
   {
     double baseline = 0.0;
     rms = 0.0;
     int cnt = 0;
     double NBins=fBaselineSample;
-    if (electronicsType=="daphne") NBins/=(fSampling/fSampling_Daphne);//correct the number of bins to the sampling frecuency. TODO: use a fixed time interval instead, then use the channel frequency to get the number of bins ~rodrigoa
+    if (channel.isDaphne) NBins/=(fSampling/fSampling_Daphne);//correct the number of bins to the sampling frecuency. TODO: use a fixed time interval instead, then use the channel frequency to get the number of bins ~rodrigoa
     // TODO: this is broken it assumes that the beginning of the
     // waveform is only noise, which is not always the case. ~icaza.
     // TODO: use std::accumulate instead of this loop. ~icaza.
@@ -244,63 +358,104 @@ namespace opdet {
     rms = sqrt(rms / cnt - baseline * baseline);
     rms = rms / sqrt(cnt - 1);
 
-    if(pdtype == "pmt_coated" || pdtype == "pmt_uncoated") {
+    // robust to pulses at the beginning of the waveform
+    if(fBaselineEstimator == BaselineEstimator::kMode)
+      baseline = util::ModeBaselineSBND(waveform, ws.baselineHist, fBaselineModeWindow);
+
+    if(channel.isPMT) {
       for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityPMT * (waveform[i] - baseline);
     }
-    else if((opdetType == "xarapuca_vuv") || (opdetType == "xarapuca_vis")) {
+    else if(channel.isArapuca) {
       for(unsigned int i = 0; i < waveform.size(); i++) waveform[i] = fPulsePolarityArapuca * (waveform[i] - baseline);
     }
     else {
-      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: " << opdetType;
+      mf::LogWarning("opHitFinder") << "Unexpected OpChannel: "
+                                    << opdet::sbndPDMapAlg::pdTypeName(channel.pdType);
       return;
     }
   }
 
 
-  // TODO: pass rms to this function once that's sorted. ~icaza
-  bool opHitFinderSBND::findAndSuppressPeak(std::vector<double>& waveform,
-                                            size_t& timebin, double& Area,
-                                            double& amplitude, const int& threshold,
-                                            const std::string& opdetType,
-                                            const std::string& electronicsType)
+  // Maximum of each block of kPeakBlockSize samples overlapping [first, last)
+  void opHitFinderSBND::computeBlockMax(std::vector<float> const& waveform, std::vector<float>& blockMax,
+                                        size_t first, size_t last) const
   {
+    blockMax.resize((waveform.size() + kPeakBlockSize - 1) / kPeakBlockSize);
+    if(first >= last) return;
+    for(size_t b = first / kPeakBlockSize; b <= (last - 1) / kPeakBlockSize; b++) {
+      auto it_b = waveform.begin() + b * kPeakBlockSize;
+      auto it_e = waveform.begin() + std::min(waveform.size(), (b + 1) * kPeakBlockSize);
+      blockMax[b] = *std::max_element(it_b, it_e);
+    }
+  }
 
-    std::vector<double>::iterator max_element_it = std::max_element(waveform.begin(), waveform.end());
-    amplitude = *max_element_it;
-    if(amplitude < threshold) return false; // stop if there's no more peaks
-    timebin = std::distance(waveform.begin(), max_element_it);
+
+  // Peaks of waveform, in order of decreasing amplitude (the earliest
+  // first for equal amplitudes), which is the order the iterative finder
+  // gives them in. The iterative finder zeroes the peaks of waveform.
+  void opHitFinderSBND::findPeaks(std::vector<float>& waveform, int threshold, PeakFinder finder,
+                                  Workspace& ws, std::vector<opdet::OpHitPeak>& peaks) const
+  {
+    if(finder == PeakFinder::kSinglePass) {
+      opdet::findOpHitPeaks(waveform, threshold, peaks);
+      std::stable_sort(peaks.begin(), peaks.end(),
+                       [](opdet::OpHitPeak const& a, opdet::OpHitPeak const& b)
+                         {return a.amplitude > b.amplitude;} );
+      return;
+    }
+
+    peaks.clear();
+    computeBlockMax(waveform, ws.blockMax, 0, waveform.size());
+    opdet::OpHitPeak peak;
+    while(findAndSuppressPeak(waveform, ws.blockMax, peak, threshold)) peaks.push_back(peak);
+  }
+
+
+  bool opHitFinderSBND::findAndSuppressPeak(std::vector<float>& waveform,
+                                            std::vector<float>& blockMax,
+                                            opdet::OpHitPeak& peak,
+                                            const int& threshold) const
+  {
+    // The highest sample is looked for among the block maxima first, and
+    // then only inside the first block holding it, which is where the first
+    // highest sample of the whole waveform is. Only the blocks of a peak
+    // need their maximum updated once it is suppressed.
+    auto max_block_it = std::max_element(blockMax.begin(), blockMax.end());
+    auto block_begin = waveform.begin() + std::distance(blockMax.begin(), max_block_it) * kPeakBlockSize;
+    auto block_end = waveform.begin() + std::min(waveform.size(),
+                                                 (std::distance(blockMax.begin(), max_block_it) + 1) * kPeakBlockSize);
+    std::vector<float>::iterator max_element_it = std::max_element(block_begin, block_end);
+    peak.amplitude = *max_element_it;
+    if(peak.amplitude < threshold) return false; // stop if there's no more peaks
+    peak.peak = std::distance(waveform.begin(), max_element_it);
 
     // it_e contains the iterator to the last element in the peak
     // where waveform is above threshold
     auto it_e = std::find_if(max_element_it,
                             waveform.end(),
-                            [threshold](const double& x)->bool
+                            [threshold](const float& x)->bool
                               {return x < threshold;} );
     // it_s contains the iterator to the first element in the peak
     // where waveform is above threshold
     auto it_s = std::find_if(std::make_reverse_iterator(max_element_it),
                             std::make_reverse_iterator(waveform.begin()),
-                            [threshold](const double& x)->bool
+                            [threshold](const float& x)->bool
                               {return x < threshold;} ).base();
 
     // integrate the area below the peak
-    // note that fSampling is in MHz and
-    // we convert it to GHz here so as to
-    // have an area in ADC*ns.
-    Area = std::accumulate(it_s, it_e, 0.0);
-    if (electronicsType == "daphne"){
-    Area = Area / (fSampling_Daphne / 1000.);}
-    else{
-    Area = Area / (fSampling / 1000.);};
+    peak.sum = std::accumulate(it_s, it_e, 0.0);
+    peak.first = std::distance(waveform.begin(), it_s);
+    peak.last = std::distance(waveform.begin(), it_e);
 
     // TODO: try to just remove this
     // TODO: better even, return iterator to last position
     std::fill(it_s, it_e, 0.0); // zeroes out that peak
+    computeBlockMax(waveform, blockMax, peak.first, peak.last);
     return true;
   } // bool opHitFinderSBND::findAndSuppressPeak()
 
 
-  void opHitFinderSBND::denoise(std::vector<double>& waveform, std::vector<double>& outwaveform)
+  void opHitFinderSBND::denoise(std::vector<float>& waveform, std::vector<float>& outwaveform) const
   {
 
     int wavelength = waveform.size();
@@ -328,9 +483,9 @@ namespace opdet {
   } // void opHitFinderSBND::denoise()
 
   // TODO: this function is not robust, check if the expected input is given and put exceptions
-  bool opHitFinderSBND::TV1D_denoise(std::vector<double>& waveform,
-                                     std::vector<double>& outwaveform,
-                                     const double lambda)
+  bool opHitFinderSBND::TV1D_denoise(std::vector<float>& waveform,
+                                     std::vector<float>& outwaveform,
+                                     const double lambda) const
   {
     int width = waveform.size();
     int k = 0, k0 = 0; // k: current sample location, k0: beginning of current segment
@@ -383,8 +538,8 @@ namespace opdet {
   } // bool opHitFinderSBND::TV1D_denoise()
 
 
-  void opHitFinderSBND::TV1D_denoise_v2(std::vector<double>& input, std::vector<double>& output,
-                                        unsigned int width, const double lambda)
+  void opHitFinderSBND::TV1D_denoise_v2(std::vector<float>& input, std::vector<float>& output,
+                                        unsigned int width, const double lambda) const
   {
     // unsigned int* indstart_low = malloc(sizeof *indstart_low * width);
     // unsigned int* indstart_up = malloc(sizeof *indstart_up * width);
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////
+// File:        opHitPeakFinderSBND.hh
+//
+// Single pass search of the optical hits of a baseline subtracted
+// waveform, used by opHitFinderSBND.
+//
+// A hit is a maximal run of consecutive samples at or above threshold;
+// its peak is the first highest sample of the run and its sum is the sum
+// of the samples of the run. These are the hits opHitFinderSBND finds by
+// repeatedly taking the highest sample of the waveform, integrating the
+// run around it and zeroing it, but here they come out of one forward
+// scan, in time order, and the waveform is left untouched.
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBND_OPDETSIM_OPHITPEAKFINDERSBND_HH
+#define SBND_OPDETSIM_OPHITPEAKFINDERSBND_HH
+
+#include <cstddef>
+#include <vector>
+
+namespace opdet {
+
+  struct OpHitPeak {
+    size_t first = 0;       // first sample of the run
+    size_t last = 0;        // one past the last sample of the run
+    size_t peak = 0;        // first highest sample
+    double amplitude = 0.;  // value of the highest sample
+    double sum = 0.;        // sum of the samples of the run
+    size_t width() const { return last - first; }
+  };
+
+  // Fill peaks with all the runs of samples >= threshold of waveform
+  template <class T>
+  void findOpHitPeaks(std::vector<T> const& waveform, int threshold, std::vector<OpHitPeak>& peaks)
+  {
+    peaks.clear();
+    const size_t n = waveform.size();
+    size_t i = 0;
+    while (i < n) {
+      if (waveform[i] < threshold) {
+        i++;
+        continue;
+      }
+      OpHitPeak peak;
+      peak.first = i;
+      peak.peak = i;
+      for (; i < n && !(waveform[i] < threshold); i++) {
+        if (waveform[i] > waveform[peak.peak]) peak.peak = i;
+        peak.sum += waveform[i];
+      }
+      peak.last = i;
+      peak.amplitude = waveform[peak.peak];
+      peaks.push_back(peak);
+    }
+  }
+
+} // namespace opdet
+
+#endif // SBND_OPDETSIM_OPHITPEAKFINDERSBND_HH
@@ -18,6 +18,12 @@
 // sensible_to_vuv: true or false
 // tpc: 0, 1
 // sampling: apsaia, daphne
+//
+// The map is compiled at construction into a channel-indexed table of
+// ChannelRecord, so that code looking up the properties of a channel for
+// every waveform pays for an array access instead of a JSON lookup and a
+// string comparison. The string based functions are kept for the
+// PDMapAlg interface and for configuration parsing.
 ////////////////////////////////////////////////////////////////////////
 
 #ifndef SBND_OPDETSIM_SBNDPDMAPALG_HH
@@ -28,9 +34,11 @@
 //#include "art/Utilities/make_tool.h"
 
 #include <algorithm>
+#include <array>
 #include <fstream>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "art_root_io/TFileService.h"
 
@@ -41,6 +49,32 @@ namespace opdet {
   class sbndPDMapAlg : PDMapAlg{
 
   public:
+    enum class PDType : unsigned char {
+      kPMTCoated, kPMTUncoated, kXArapucaVUV, kXArapucaVIS, kUnknown
+    };
+    static constexpr size_t kNPDTypes = static_cast<size_t>(PDType::kUnknown);
+
+    enum class Electronics : unsigned char {
+      kNone, kApsaia, kDaphne, kUnknown
+    };
+
+    struct ChannelRecord {
+      PDType pdType = PDType::kUnknown;
+      Electronics electronics = Electronics::kUnknown;
+      bool isPMT = false;
+      bool isArapuca = false;
+      bool isDaphne = false;      // sampled at the DAPHNE frequency
+      bool sensibleToVUV = false;
+      bool sensibleToVIS = false;
+      int pdsBox = -1;
+      int tpc = -1;
+    };
+
+    static PDType pdTypeFromName(std::string const& name);
+    static std::string const& pdTypeName(PDType type);
+    static Electronics electronicsFromName(std::string const& name);
+    static std::string const& electronicsName(Electronics electronics);
+
     //Default constructor
     explicit sbndPDMapAlg(const fhicl::ParameterSet& pset);
     sbndPDMapAlg() : sbndPDMapAlg(fhicl::ParameterSet()) {}
@@ -65,9 +99,25 @@ namespace opdet {
     size_t size() const;
     auto getChannelEntry(size_t ch) const;
 
+    // Typed access to the compiled table
+    ChannelRecord const& channelRecord(size_t ch) const { return fChannelRecords.at(ch); }
+    PDType pdTypeOf(size_t ch) const { return fChannelRecords.at(ch).pdType; }
+    Electronics electronicsOf(size_t ch) const { return fChannelRecords.at(ch).electronics; }
+    bool isPMT(size_t ch) const { return fChannelRecords.at(ch).isPMT; }
+    bool isArapuca(size_t ch) const { return fChannelRecords.at(ch).isArapuca; }
+    bool isDaphne(size_t ch) const { return fChannelRecords.at(ch).isDaphne; }
+    std::vector<int> const& getChannelsOfType(PDType type) const;
+    std::vector<int> const& getChannelsSensibleToVUV() const { return fChannelsSensibleToVUV; }
+    std::vector<int> const& getChannelsSensibleToVIS() const { return fChannelsSensibleToVIS; }
+
   private:
     nlohmann::json PDmap;
 
+    std::vector<ChannelRecord> fChannelRecords;
+    std::array<std::vector<int>, kNPDTypes + 1> fChannelsOfType; // last one for unknown types
+    std::vector<int> fChannelsSensibleToVUV;
+    std::vector<int> fChannelsSensibleToVIS;
+
   }; // class sbndPDMapAlg
 
   template<typename T>
@@ -17,40 +17,96 @@ namespace opdet {
     std::ifstream i(fname, std::ifstream::in);
     i >> PDmap;
     i.close();
+
+    // compile the map into the channel-indexed table
+    fChannelRecords.resize(PDmap.size());
+    for (size_t ch = 0; ch < PDmap.size(); ch++) {
+      nlohmann::json const& entry = PDmap.at(ch);
+      ChannelRecord& record = fChannelRecords[ch];
+      record.pdType = pdTypeFromName(entry.value("pd_type", std::string()));
+      record.electronics = electronicsFromName(entry.value("electronics", std::string()));
+      record.isPMT = (record.pdType == PDType::kPMTCoated || record.pdType == PDType::kPMTUncoated);
+      record.isArapuca = (record.pdType == PDType::kXArapucaVUV || record.pdType == PDType::kXArapucaVIS);
+      record.isDaphne = (record.electronics == Electronics::kDaphne);
+      record.sensibleToVUV = entry.value("sensible_to_vuv", false);
+      record.sensibleToVIS = entry.value("sensible_to_vis", false);
+      record.pdsBox = entry.value("pds_box", -1);
+      record.tpc = entry.value("tpc", -1);
+
+      fChannelsOfType[static_cast<size_t>(record.pdType)].push_back(ch);
+      if (record.sensibleToVUV) fChannelsSensibleToVUV.push_back(ch);
+      if (record.sensibleToVIS) fChannelsSensibleToVIS.push_back(ch);
+    }
   }
 
   sbndPDMapAlg::~sbndPDMapAlg()
   { }
 
+  namespace {
+    const std::array<std::string, sbndPDMapAlg::kNPDTypes + 1> kPDTypeNames {
+      "pmt_coated", "pmt_uncoated", "xarapuca_vuv", "xarapuca_vis", "unknown"
+    };
+    const std::array<std::string, 4> kElectronicsNames {
+      "", "apsaia", "daphne", "unknown"
+    };
+  }
+
+  sbndPDMapAlg::PDType sbndPDMapAlg::pdTypeFromName(std::string const& name)
+  {
+    for (size_t i = 0; i < kNPDTypes; i++) {
+      if (kPDTypeNames[i] == name) return static_cast<PDType>(i);
+    }
+    return PDType::kUnknown;
+  }
+
+  std::string const& sbndPDMapAlg::pdTypeName(PDType type)
+  {
+    return kPDTypeNames[static_cast<size_t>(type)];
+  }
+
+  sbndPDMapAlg::Electronics sbndPDMapAlg::electronicsFromName(std::string const& name)
+  {
+    for (size_t i = 0; i + 1 < kElectronicsNames.size(); i++) {
+      if (kElectronicsNames[i] == name) return static_cast<Electronics>(i);
+    }
+    return Electronics::kUnknown;
+  }
+
+  std::string const& sbndPDMapAlg::electronicsName(Electronics electronics)
+  {
+    return kElectronicsNames[static_cast<size_t>(electronics)];
+  }
+
   bool sbndPDMapAlg::isPDType(size_t ch, std::string pdname) const
   {
-    if(PDmap.at(ch)["pd_type"] == std::string(pdname)) return true;
-    return false;
+    return pdTypeName(pdTypeOf(ch)) == pdname;
   }
 
   bool sbndPDMapAlg::isElectronics(size_t ch, std::string pdname) const
   {
-    if(PDmap.at(ch)["electronics"] == std::string(pdname)) return true; // TODO: add number of electronics, daphne01, daphne02, .... ~rodrigoa
-    return false;
+    return electronicsName(electronicsOf(ch)) == pdname; // TODO: add number of electronics, daphne01, daphne02, .... ~rodrigoa
   }
 
   std::string sbndPDMapAlg::pdType(size_t ch) const
   {
-    return PDmap.at(ch)["pd_type"];
+    return pdTypeName(pdTypeOf(ch));
   }
 
   std::string sbndPDMapAlg::electronicsType(size_t ch) const
   {
-    return PDmap.at(ch)["electronics"]; 
+    return electronicsName(electronicsOf(ch));
   }
 
   std::vector<int> sbndPDMapAlg::getChannelsOfType(std::string pdname) const
   {
-    std::vector<int> out_ch_v;
-    for (size_t ch = 0; ch < PDmap.size(); ch++) {
-      if (PDmap.at(ch)["pd_type"] == pdname) out_ch_v.push_back(ch);
-    }
-    return out_ch_v;
+    PDType type = pdTypeFromName(pdname);
+    if (type == PDType::kUnknown) return std::vector<int>();
+    return getChannelsOfType(type);
+  }
+
+  std::vector<int> const& sbndPDMapAlg::getChannelsOfType(PDType type) const
+  {
+    return fChannelsOfType[static_cast<size_t>(type)];
   }
 
   size_t sbndPDMapAlg::size() const
@@ -0,0 +1,115 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   BaselineUtilsSBND.h
+///
+/// \brief  Histogram-free helpers to estimate the baseline of a waveform
+///         from the mode of its samples.
+///
+/// ModeHistogramSBND is a plain integer histogram with the binning
+/// conventions of a ROOT TH1 with fixed bins: the bin of a value, the
+/// first bin with the most entries and the centre of a bin are computed
+/// in the same way, so for a range with high above low the mode is the
+/// same as the one of a TH1F filled with the same values. It makes no
+/// ROOT object, so it can be used from any thread, and its counts are
+/// kept between uses: a histogram owned by a worker does not allocate
+/// once it has seen its largest binning.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_BASELINEUTILSSBND_H
+#define SBNDCODE_UTILITIES_BASELINEUTILSSBND_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+  //----------------------------------------------------------------------
+  class ModeHistogramSBND {
+  public:
+
+    // Empty the histogram and set nBins bins over [low, high). As for a
+    // TH1, less than one bin means one bin. If high is not above low no
+    // value is counted and the mode is low; a TH1 would instead set its
+    // range from the values it is filled with.
+    void Reset(int nBins, double low, double high)
+    {
+      fNBins = std::max(nBins, 1);
+      fLow = low;
+      fHigh = high;
+      fCounts.assign(fNBins, 0);
+    }
+
+    // Values out of [low, high) are not counted, as under/overflows of a TH1
+    void Fill(double x)
+    {
+      if (x < fLow || !(x < fHigh)) return;
+      // a value just below high can still be rounded into bin fNBins, which
+      // a TH1 takes as an overflow too
+      const int bin = int(fNBins*(x - fLow)/(fHigh - fLow));
+      if (bin < fNBins) fCounts[bin]++;
+    }
+
+    int NBins() const { return fNBins; }
+    double Low() const { return fLow; }
+    double High() const { return fHigh; }
+
+    // Entries in bin, numbered from 1 as in a TH1
+    unsigned Count(int bin) const { return fCounts[bin - 1]; }
+
+    // First bin with the most entries, numbered from 1 as in a TH1
+    int MaximumBin() const
+    {
+      return 1 + (std::max_element(fCounts.begin(), fCounts.end()) - fCounts.begin());
+    }
+
+    double BinCenter(int bin) const
+    {
+      const double width = (fHigh - fLow)/double(fNBins);
+      return fLow + (bin - 1)*width + 0.5*width;
+    }
+
+    // Centre of the first bin with the most entries
+    double Mode() const { return BinCenter(MaximumBin()); }
+
+  private:
+    int                   fNBins = 1;
+    double                fLow = 0.;
+    double                fHigh = 0.;
+    std::vector<unsigned> fCounts;
+  };
+
+  //----------------------------------------------------------------------
+  // Baseline of a waveform robust to the pulses on it: the mode of the
+  // samples, in bins one ADC count wide between the lowest and the highest
+  // sample, refined by the mean of the samples within window of it.
+  // A flat waveform has its only value as baseline.
+  template <class T>
+  double ModeBaselineSBND(std::vector<T> const& wave, ModeHistogramSBND& hist, double window)
+  {
+    if (wave.empty()) return 0.;
+    auto const range = std::minmax_element(wave.begin(), wave.end());
+    const double min = *range.first;
+    const double max = *range.second;
+    if (!(max - min >= 1.)) return min;
+
+    hist.Reset(int(max - min), min, max);
+    for (T const& x : wave) hist.Fill(x);
+    const double mode = hist.Mode();
+
+    double sum = 0.;
+    size_t count = 0;
+    for (T const& x : wave) {
+      if (std::abs(x - mode) < window) {
+        sum += x;
+        count++;
+      }
+    }
+    return count ? sum/count : mode;
+  }
+
+} // namespace util
+
+#endif // SBNDCODE_UTILITIES_BASELINEUTILSSBND_H
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////////////////
+/// \file   FFTPlanCacheSBND.cc
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/FFTPlanCacheSBND.h"
+
+#include "TFFTRealComplex.h"
+#include "TFFTComplexReal.h"
+#include "TVirtualFFT.h"
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <tuple>
+
+namespace {
+
+  using PlanKey = std::tuple<int, int, unsigned, std::string>; // size, direction, slot, option
+
+  // the FFTW planner is not reentrant: this also serialises plan creation
+  std::mutex gPlanCacheMutex;
+
+  // never deleted: the plans must outlive every user, including the ones
+  // destroyed at the end of the job
+  std::map<PlanKey, TVirtualFFT*>& Plans()
+  {
+    static auto* plans = new std::map<PlanKey, TVirtualFFT*>;
+    return *plans;
+  }
+
+  util::FFTPlanCacheSBND::Counters gCounters;
+
+  TVirtualFFT* GetPlan(int size, int direction, unsigned slot, std::string const& option)
+  {
+    std::lock_guard<std::mutex> lock(gPlanCacheMutex);
+
+    TVirtualFFT*& plan = Plans()[PlanKey(size, direction, slot, option)];
+    if (plan) {
+      ++gCounters.hits;
+      return plan;
+    }
+
+    ++gCounters.misses;
+    auto const start = std::chrono::steady_clock::now();
+    int dummy[1] = {0};
+    if (direction == util::FFTPlanCacheSBND::kForward) {
+      auto* fft = new TFFTRealComplex(size, false);
+      fft->Init(option.c_str(), -1, dummy);
+      plan = fft;
+    }
+    else {
+      auto* fft = new TFFTComplexReal(size, false);
+      fft->Init(option.c_str(), 1, dummy);
+      plan = fft;
+    }
+    gCounters.planSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return plan;
+  }
+
+}
+
+//----------------------------------------------------------------------
+TFFTRealComplex* util::FFTPlanCacheSBND::ForwardPlan(int size, unsigned slot, std::string const& option)
+{
+  return static_cast<TFFTRealComplex*>(GetPlan(size, kForward, slot, option));
+}
+
+//----------------------------------------------------------------------
+TFFTComplexReal* util::FFTPlanCacheSBND::InversePlan(int size, unsigned slot, std::string const& option)
+{
+  return static_cast<TFFTComplexReal*>(GetPlan(size, kInverse, slot, option));
+}
+
+//----------------------------------------------------------------------
+util::FFTPlanCacheSBND::Counters util::FFTPlanCacheSBND::GetCounters()
+{
+  std::lock_guard<std::mutex> lock(gPlanCacheMutex);
+  return gCounters;
+}
+
+//----------------------------------------------------------------------
+std::string util::FFTPlanCacheSBND::Summary()
+{
+  Counters const counters = GetCounters();
+  std::ostringstream out;
+  out << "FFT plan cache: " << counters.misses << " plans made in " << counters.planSeconds
+      << " s, " << counters.hits << " lookups reused a plan";
+  return out.str();
+}
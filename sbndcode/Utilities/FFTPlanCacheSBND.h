@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   FFTPlanCacheSBND.h
+///
+/// \brief  Job-wide cache of FFTW plans keyed by (size, direction, slot).
+///
+/// Making an FFTW plan is much more expensive than running it, and the
+/// planner is not thread-safe, so plans are made once and kept for the
+/// whole job. A plan also owns its input and output arrays, so it can only
+/// be run by one thread at a time: the slot identifies its user. Code run
+/// by the art thread uses slot 0; code that spreads work over several
+/// threads gives each worker a slot of its own (see kWorkerSlot).
+///
+/// Hits, misses and the time spent planning are counted for the job and
+/// can be reported with Summary().
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_FFTPLANCACHESBND_H
+#define SBNDCODE_UTILITIES_FFTPLANCACHESBND_H
+
+#include <string>
+
+class TFFTRealComplex;
+class TFFTComplexReal;
+
+namespace util {
+
+  class FFTPlanCacheSBND {
+  public:
+
+    enum Direction { kForward, kInverse };
+
+    // First slot for parallel workers; worker i uses kWorkerSlot + i, so
+    // that they never share plans with the art thread.
+    static constexpr unsigned kWorkerSlot = 1;
+
+    struct Counters {
+      unsigned long hits        = 0;  ///< lookups served by an existing plan
+      unsigned long misses      = 0;  ///< lookups that had to make a plan
+      double        planSeconds = 0.; ///< time spent making plans
+    };
+
+    // Plans of the given size for slot, made with FFTW option (as LArFFT).
+    // The cache keeps ownership until the end of the job.
+    static TFFTRealComplex* ForwardPlan(int size, unsigned slot = 0, std::string const& option = "");
+    static TFFTComplexReal* InversePlan(int size, unsigned slot = 0, std::string const& option = "");
+
+    static Counters GetCounters();
+
+    // One line with the counters, for the job log.
+    static std::string Summary();
+  };
+
+}
+
+#endif // SBNDCODE_UTILITIES_FFTPLANCACHESBND_H
@@ -0,0 +1,15 @@
+////////////////////////////////////////////////////////////////////////
+/// \file   FFTWorkspaceSBND.cc
+////////////////////////////////////////////////////////////////////////
+
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
+
+//----------------------------------------------------------------------
+util::FFTWorkspaceSBND::FFTWorkspaceSBND(int size, std::string const& option, unsigned slot)
+  : fSize(size)
+  , fFreqSize(size/2 + 1)
+  , fFFT(util::FFTPlanCacheSBND::ForwardPlan(size, slot, option))
+  , fInverseFFT(util::FFTPlanCacheSBND::InversePlan(size, slot, option))
+  , fFreqArray(size/2 + 1)
+{
+}
@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////
+///
+/// \file   FFTWorkspaceSBND.h
+///
+/// \brief  Thread-private FFT work area with the same conventions as
+///         util::LArFFT.
+///
+/// util::LArFFT keeps a single pair of FFTW plans and work arrays for the
+/// whole job, so it can only be used from one thread at a time, and it has
+/// to be reinitialised whenever a different size is needed. A
+/// FFTWorkspaceSBND takes its plans from util::FFTPlanCacheSBND for the
+/// slot of the thread that will use it, so it is cheap to make for any size
+/// and can be given to a worker thread. Plans are made with the same
+/// options as LArFFT and the inverse transform is normalised by 1/N in the
+/// same way, so the results are identical to the ones of the service.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_FFTWORKSPACESBND_H
+#define SBNDCODE_UTILITIES_FFTWORKSPACESBND_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "sbndcode/Utilities/FFTPlanCacheSBND.h"
+
+#include "TComplex.h"
+#include "TFFTRealComplex.h"
+#include "TFFTComplexReal.h"
+
+namespace util {
+
+  class FFTWorkspaceSBND {
+  public:
+
+    // Workspaces with the same size, option and slot share their plans, so
+    // they must only be used from the thread owning that slot.
+    FFTWorkspaceSBND(int size, std::string const& option = "", unsigned slot = 0);
+
+    FFTWorkspaceSBND(FFTWorkspaceSBND const&) = delete;
+    FFTWorkspaceSBND& operator=(FFTWorkspaceSBND const&) = delete;
+
+    int FFTSize() const { return fSize; }
+    int FreqSize() const { return fFreqSize; }
+
+    // Forward transform; input shorter than FFTSize() is zero padded.
+    template <class T> void DoFFT(std::vector<T> const& input, std::vector<TComplex>& output);
+
+    // Inverse transform, normalised by 1/FFTSize() as in LArFFT.
+    template <class T> void DoInvFFT(std::vector<TComplex> const& input, std::vector<T>& output);
+
+    // Inverse transform of a spectrum given as FreqSize() real and
+    // imaginary parts, normalised as DoInvFFT.
+    template <class T> void DoInvFFT(float const* re, float const* im, std::vector<T>& output);
+
+    // Multiply the spectrum of func by kern (FreqSize() bins) in place.
+    template <class T> void Convolute(std::vector<T>& func, std::vector<TComplex> const& kern);
+
+  private:
+
+    int fSize;
+    int fFreqSize;
+    TFFTRealComplex* fFFT;         ///< owned by FFTPlanCacheSBND
+    TFFTComplexReal* fInverseFFT;  ///< owned by FFTPlanCacheSBND
+    std::vector<TComplex> fFreqArray;
+  };
+
+}
+
+//----------------------------------------------------------------------
+template <class T> inline void util::FFTWorkspaceSBND::DoFFT(std::vector<T> const& input,
+                                                             std::vector<TComplex>& output)
+{
+  const size_t n = std::min(input.size(), (size_t) fSize);
+  for (size_t p = 0; p < n; ++p)
+    fFFT->SetPoint(p, input[p]);
+  for (size_t p = n; p < (size_t) fSize; ++p)
+    fFFT->SetPoint(p, 0.);
+
+  fFFT->Transform();
+
+  double real = 0.;
+  double imaginary = 0.;
+  if (output.size() < (size_t) fFreqSize) output.resize(fFreqSize);
+  for (int i = 0; i < fFreqSize; ++i) {
+    fFFT->GetPointComplex(i, real, imaginary);
+    output[i] = TComplex(real, imaginary);
+  }
+}
+
+//----------------------------------------------------------------------
+template <class T> inline void util::FFTWorkspaceSBND::DoInvFFT(std::vector<TComplex> const& input,
+                                                                std::vector<T>& output)
+{
+  for (int i = 0; i < fFreqSize; ++i) {
+    TComplex point = input[i];
+    fInverseFFT->SetPointComplex(i, point);
+  }
+
+  fInverseFFT->Transform();
+  double factor = 1.0/(double) fSize;
+
+  if (output.size() < (size_t) fSize) output.resize(fSize);
+  for (int i = 0; i < fSize; ++i)
+    output[i] = factor*fInverseFFT->GetPointReal(i, false);
+}
+
+//----------------------------------------------------------------------
+template <class T> inline void util::FFTWorkspaceSBND::DoInvFFT(float const* re, float const* im,
+                                                                std::vector<T>& output)
+{
+  for (int i = 0; i < fFreqSize; ++i)
+    fInverseFFT->SetPoint(i, re[i], im[i]);
+
+  fInverseFFT->Transform();
+  double factor = 1.0/(double) fSize;
+
+  if (output.size() < (size_t) fSize) output.resize(fSize);
+  for (int i = 0; i < fSize; ++i)
+    output[i] = factor*fInverseFFT->GetPointReal(i, false);
+}
+
+//----------------------------------------------------------------------
+template <class T> inline void util::FFTWorkspaceSBND::Convolute(std::vector<T>& func,
+                                                                 std::vector<TComplex> const& kern)
+{
+  DoFFT(func, fFreqArray);
+  for (int i = 0; i < fFreqSize; ++i)
+    fFreqArray[i] *= kern[i];
+  DoInvFFT(fFreqArray, func);
+}
+
+#endif // SBNDCODE_UTILITIES_FFTWORKSPACESBND_H
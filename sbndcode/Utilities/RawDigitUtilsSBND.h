@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   RawDigitUtilsSBND.h
+///
+/// \brief  Decoding of the ADC counts of a raw::RawDigit into a float
+///         waveform, with the pedestal subtracted and the padding of the
+///         FFT applied, for the modules reading TPC digits.
+///
+/// Decoding, pedestal subtraction and zero padding are done while the
+/// output buffer is written, instead of as three loops over a short
+/// buffer and a float one. Uncompressed digits are read directly; the
+/// compressed ones are expanded by raw::Uncompress, which owns the
+/// Huffman and zero suppression formats, into a scratch buffer that the
+/// decoder keeps between digits.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_RAWDIGITUTILSSBND_H
+#define SBNDCODE_UTILITIES_RAWDIGITUTILSSBND_H
+
+#include "lardataobj/RawData/RawDigit.h"
+#include "lardataobj/RawData/raw.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace util {
+
+  class RawDigitDecoderSBND {
+  public:
+
+    // out[i] = ADC[i] - pedestal for the Samples() of the digit, then zeros
+    // up to padSize samples. With fillWithPedestal, the zero suppressed
+    // samples of a compressed digit are at the pedestal (0 once it is
+    // subtracted) rather than at 0 ADC, as raw::Uncompress with a pedestal.
+    template <class T>
+    void Decode(raw::RawDigit const& digit, float pedestal, size_t padSize,
+                std::vector<T>& out, bool fillWithPedestal = false)
+    {
+      switch (digit.Compression()) {
+        case raw::kNone:
+          DecodeKernel<raw::kNone>(digit, pedestal, padSize, out, fillWithPedestal);
+          break;
+        case raw::kHuffman:
+        default:
+          // every compressed format is expanded by raw::Uncompress
+          DecodeKernel<raw::kHuffman>(digit, pedestal, padSize, out, fillWithPedestal);
+          break;
+      }
+    }
+
+  private:
+
+    template <raw::Compress_t Compression, class T>
+    void DecodeKernel(raw::RawDigit const& digit, float pedestal, size_t padSize,
+                      std::vector<T>& out, bool fillWithPedestal)
+    {
+      const size_t nSamples = digit.Samples();
+      out.resize(std::max(nSamples, padSize));
+
+      short const* adc;
+      size_t nStored = nSamples;
+      if constexpr (Compression == raw::kNone) {
+        // the counts are stored as they are; missing ones are read as 0 ADC
+        adc = digit.ADCs().data();
+        nStored = std::min(nSamples, digit.ADCs().size());
+      }
+      else {
+        fScratch.assign(nSamples, 0);
+        if (fillWithPedestal)
+          raw::Uncompress(digit.ADCs(), fScratch, (int) pedestal, digit.Compression());
+        else
+          raw::Uncompress(digit.ADCs(), fScratch, digit.Compression());
+        adc = fScratch.data();
+      }
+
+      T* wave = out.data();
+      for (size_t i = 0; i < nStored; ++i) wave[i] = adc[i] - pedestal;
+      std::fill(wave + nStored, wave + nSamples, T(-pedestal));
+      std::fill(wave + nSamples, wave + out.size(), T(0));
+    }
+
+    std::vector<short> fScratch; ///< counts of compressed digits
+  };
+
+} // namespace util
+
+#endif // SBNDCODE_UTILITIES_RAWDIGITUTILSSBND_H
@@ -38,6 +38,7 @@
 #include "larcore/Geometry/Geometry.h"
 #include "larcorealg/Geometry/TPCGeo.h"
 #include "larcorealg/Geometry/PlaneGeo.h"
+#include "sbndcode/Utilities/FFTWorkspaceSBND.h"
 namespace detinfo { class DetectorClocksData; }
 
 #include "TF1.h"
@@ -79,13 +80,31 @@ namespace util {
     template <class T> void Convolute(detinfo::DetectorClocksData const& clockData,
                                       unsigned int channel, std::vector<T>& func) const;
 
+    // Do convolution with a caller-owned FFT workspace instead of the LArFFT
+    // service. The shaping and the time offset have to be fetched beforehand
+    // with SignalShaping() and FieldResponseTOffset(), so that this can be
+    // called from worker threads.
+
+    template <class T> static void Convolute(util::SignalShaping const& shaping, int time_offset,
+                                             std::vector<T>& func, util::FFTWorkspaceSBND& fft);
+
     // Do deconvolution calcution (for reconstruction).
 
     template <class T> void Deconvolute(detinfo::DetectorClocksData const& clockData,
                                         unsigned int channel, std::vector<T>& func) const;
 
+    // Do deconvolution with a caller-owned FFT workspace, as Convolute above.
+
+    template <class T> static void Deconvolute(util::SignalShaping const& shaping, int time_offset,
+                                               std::vector<T>& func, util::FFTWorkspaceSBND& fft);
+
     double GetDeconNorm(){return fDeconNorm;};
 
+    // Undo the field response time offset after a convolution/deconvolution.
+
+    template <class T> static void ShiftConvoluted(int time_offset, std::vector<T>& func);
+    template <class T> static void ShiftDeconvoluted(int time_offset, std::vector<T>& func);
+
   private:
 
     // Private configuration methods.
@@ -183,7 +202,51 @@ template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo
 
   //negative number;
   int time_offset = FieldResponseTOffset(clockData, channel);
+
+  ShiftConvoluted(time_offset, func);
+}
+
+
+//----------------------------------------------------------------------
+// Do convolution with a private FFT workspace.
+template <class T> inline void util::SignalShapingServiceSBND::Convolute(util::SignalShaping const& shaping, int time_offset,
+                                                                         std::vector<T>& func, util::FFTWorkspaceSBND& fft)
+{
+  fft.Convolute(func, shaping.ConvKernel());
+
+  ShiftConvoluted(time_offset, func);
+}
+
+
+//----------------------------------------------------------------------
+// Do deconvolution.
+template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detinfo::DetectorClocksData const& clockData,
+                                                                           unsigned int channel, std::vector<T>& func) const
+{
+  SignalShaping(channel).Deconvolute(func);
   
+  //negative number;
+  int time_offset = FieldResponseTOffset(clockData, channel);
+
+  ShiftDeconvoluted(time_offset, func);
+}
+
+
+//----------------------------------------------------------------------
+// Do deconvolution with a private FFT workspace.
+template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(util::SignalShaping const& shaping, int time_offset,
+                                                                           std::vector<T>& func, util::FFTWorkspaceSBND& fft)
+{
+  fft.Convolute(func, shaping.DeconvKernel());
+
+  ShiftDeconvoluted(time_offset, func);
+}
+
+
+//----------------------------------------------------------------------
+// Rotate a convolved waveform by the field response time offset.
+template <class T> inline void util::SignalShapingServiceSBND::ShiftConvoluted(int time_offset, std::vector<T>& func)
+{
   std::vector<T> temp;
   if (time_offset <= 0) {
     temp.assign(func.begin(),func.begin()-time_offset);
@@ -198,15 +261,9 @@ template <class T> inline void util::SignalShapingServiceSBND::Convolute(detinfo
 
 
 //----------------------------------------------------------------------
-// Do deconvolution.
-template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detinfo::DetectorClocksData const& clockData,
-                                                                           unsigned int channel, std::vector<T>& func) const
+// Rotate a deconvolved waveform back by the field response time offset.
+template <class T> inline void util::SignalShapingServiceSBND::ShiftDeconvoluted(int time_offset, std::vector<T>& func)
 {
-  SignalShaping(channel).Deconvolute(func);
-  
-  //negative number;
-  int time_offset = FieldResponseTOffset(clockData, channel);
-  
   std::vector<T> temp;
   if (time_offset <= 0) {
     temp.assign(func.end()+time_offset,func.end());
@@ -217,7 +274,6 @@ template <class T> inline void util::SignalShapingServiceSBND::Deconvolute(detin
     func.erase(func.begin(),func.begin()+time_offset);
     func.insert(func.end(),temp.begin(),temp.end());
   }
-  
 }
 
 DECLARE_ART_SERVICE(util::SignalShapingServiceSBND, LEGACY)
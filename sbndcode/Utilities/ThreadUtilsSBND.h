@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////
+///
+/// \file   ThreadUtilsSBND.h
+///
+/// \brief  Small helpers shared by the SBND modules that split their
+///         per-channel work over several threads.
+///
+/// The thread count convention follows opDetDigitizerSBND: a configured
+/// value of 0 means "autodetect", which first reads an environment
+/// variable and then falls back to the number of hardware cores.
+///
+////////////////////////////////////////////////////////////////////////
+
+#ifndef SBNDCODE_UTILITIES_THREADUTILSSBND_H
+#define SBNDCODE_UTILITIES_THREADUTILSSBND_H
+
+#include "messagefacility/MessageLogger/MessageLogger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+  //----------------------------------------------------------------------
+  // Turn a configured number of threads into the number actually used.
+  // 0 means autodetect: the environment variable envVar is checked first,
+  // then the number of hardware cores on the host machine.
+  inline unsigned ResolveNThreads(unsigned nThreads,
+                                  std::string const& envVar,
+                                  std::string const& category)
+  {
+    if (nThreads == 0) { // autodetect -- first check env var
+      const char *env = std::getenv(envVar.c_str());
+      // try to parse into positive integer
+      if (env != NULL) {
+        try {
+          int n_threads = std::stoi(env);
+          if (n_threads <= 0) {
+            throw std::invalid_argument("Expect positive integer");
+          }
+          nThreads = n_threads;
+        }
+        catch (...) {
+          mf::LogError(category) << "Unable to parse number of threads "
+                                 << "in environment variable (" << envVar << "): (" << env << ").\n"
+                                 << "Setting number of threads to 1." << std::endl;
+          nThreads = 1;
+        }
+      }
+    }
+
+    if (nThreads == 0) { // autodetect -- now try to get number of cpu's
+      nThreads = std::thread::hardware_concurrency();
+    }
+    if (nThreads == 0) { // autodetect failed
+      nThreads = 1;
+    }
+    return nThreads;
+  }
+
+  //----------------------------------------------------------------------
+  // Call func(job, worker) for every job in [0, nJobs) using up to nThreads
+  // threads, worker being the index of the calling thread in [0, nThreads).
+  // Jobs are handed out one at a time from a shared counter, so func must
+  // only write to per-job or per-worker state; the results are then
+  // independent of the number of threads. With a single thread (or a
+  // single job) everything runs in the calling thread.
+  // The first exception thrown by a job is rethrown in the calling thread
+  // once all the workers have stopped.
+  template <class Func>
+  void ParallelForEach(unsigned nThreads, size_t nJobs, Func&& func)
+  {
+    const unsigned nWorkers = std::max(1u, (unsigned) std::min<size_t>(nThreads, nJobs));
+    if (nWorkers == 1) {
+      for (size_t job = 0; job < nJobs; ++job) func(job, 0u);
+      return;
+    }
+
+    std::atomic<size_t> nextJob{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+    auto work = [&](unsigned worker) {
+      try {
+        for (size_t job = nextJob++; job < nJobs; job = nextJob++) func(job, worker);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if (!error) error = std::current_exception();
+        nextJob = nJobs; // let the other workers stop early
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nWorkers - 1);
+    for (unsigned worker = 1; worker < nWorkers; ++worker) threads.emplace_back(work, worker);
+    work(0);
+    for (std::thread &thread : threads) thread.join();
+
+    if (error) std::rethrow_exception(error);
+  }
+
+} // namespace util
+
+#endif // SBNDCODE_UTILITIES_THREADUTILSSBND_H
@@ -0,0 +1,83 @@
+/**
+ * @file   BaselineUtilsSBND_test.cxx
+ * @brief  Unit test for the mode histogram of BaselineUtilsSBND.h
+ *
+ * Usage: just run the executable.
+ */
+
+#define BOOST_TEST_MODULE BaselineUtilsSBNDTest
+#include <boost/test/unit_test.hpp>
+
+// SBND libraries
+#include "sbndcode/Utilities/BaselineUtilsSBND.h"
+
+// C/C++ standard libraries
+#include <cmath>
+#include <vector>
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(ModeHistogramBinning_test) {
+
+  util::ModeHistogramSBND hist;
+  hist.Reset(4, 0., 4.);
+
+  hist.Fill(-0.5); // underflow
+  hist.Fill(0.);
+  hist.Fill(2.5);
+  hist.Fill(2.9);
+  hist.Fill(4.);   // overflow
+
+  BOOST_TEST(hist.Count(1) == 1U);
+  BOOST_TEST(hist.Count(2) == 0U);
+  BOOST_TEST(hist.Count(3) == 2U);
+  BOOST_TEST(hist.Count(4) == 0U);
+  BOOST_TEST(hist.MaximumBin() == 3);
+  BOOST_TEST(hist.Mode() == 2.5);
+
+} // BOOST_AUTO_TEST_CASE(ModeHistogramBinning_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(ModeHistogramUpperEdge_test) {
+
+  // with a low edge far from 0, the last value below the high edge is
+  // rounded into the bin past the last one: it must be left out as an
+  // overflow rather than written past the counts
+  const double low  = -4096.3;
+  const double high = low + 4095.;
+  const int    nBins = 4095;
+
+  util::ModeHistogramSBND hist;
+  hist.Reset(nBins, low, high);
+
+  const double x = std::nextafter(high, low);
+  BOOST_TEST(x < high);
+  BOOST_TEST(int(nBins*(x - low)/(high - low)) == nBins);
+
+  hist.Fill(x);
+  unsigned total = 0;
+  for (int bin = 1; bin <= hist.NBins(); ++bin) total += hist.Count(bin);
+  BOOST_TEST(total == 0U);
+
+  hist.Fill(high - 0.5);
+  BOOST_TEST(hist.Count(nBins) == 1U);
+  BOOST_TEST(hist.MaximumBin() == nBins);
+
+} // BOOST_AUTO_TEST_CASE(ModeHistogramUpperEdge_test)
+
+
+//------------------------------------------------------------------------------
+BOOST_AUTO_TEST_CASE(ModeBaseline_test) {
+
+  util::ModeHistogramSBND hist;
+
+  // a flat waveform has its only value as baseline
+  BOOST_TEST(util::ModeBaselineSBND(std::vector<float>(10, 3.f), hist, 2.) == 3.);
+
+  // a pulse on a flat baseline does not move it
+  std::vector<float> wave(100, 10.f);
+  for (size_t i = 40; i < 45; ++i) wave[i] = 50.f;
+  BOOST_TEST(util::ModeBaselineSBND(wave, hist, 2.) == 10.);
+
+} // BOOST_AUTO_TEST_CASE(ModeBaseline_test)